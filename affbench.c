@@ -0,0 +1,93 @@
+// Show what CPU affinity buys a cache-bound workload. Two
+// processes per CPU each sweep their own working set over and
+// over, in three modes:
+//   pinned  each process stays on one CPU (setaffinity)
+//   free    the scheduler decides, preferring the last CPU used
+//   bounce  each process hops to the next CPU every few passes,
+//           starting cold each time, as with no CPU preference
+// Run with CPUS=4 (or more) to see a difference.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "procinfo.h"
+
+#define WSET    (128*1024)  // bytes swept by each process
+#define PASSES  400
+#define BOUNCE  4           // passes between hops in bounce mode
+
+static char buf[WSET];
+static struct procinfo info[NPROC];
+
+// Sweep buf PASSES times as child i of the given mode, then
+// report how often the kernel migrated us.
+static void
+child(int i, int ncpu, char *mode, int fd)
+{
+  int pass, j, n, me;
+  uint nmigrate;
+
+  if(mode[0] == 'p')
+    setaffinity(0, 1 << (i % ncpu));
+  for(pass = 0; pass < PASSES; pass++){
+    if(mode[0] == 'b' && pass % BOUNCE == 0)
+      setaffinity(0, 1 << ((i + pass / BOUNCE) % ncpu));
+    for(j = 0; j < WSET; j += 64)
+      buf[j]++;
+  }
+
+  nmigrate = 0;
+  me = getpid();
+  n = getprocinfo(info, NPROC);
+  for(j = 0; j < n; j++)
+    if(info[j].pid == me)
+      nmigrate = info[j].nmigrate;
+  write(fd, &nmigrate, sizeof(nmigrate));
+  exit();
+}
+
+static void
+run(char *mode, int ncpu)
+{
+  int fd[2], i, nkid;
+  uint start, total, n;
+
+  if(pipe(fd) < 0){
+    printf(2, "affbench: pipe failed\n");
+    exit();
+  }
+  nkid = 2 * ncpu;
+  start = uptime();
+  for(i = 0; i < nkid; i++){
+    if(fork() == 0){
+      close(fd[0]);
+      child(i, ncpu, mode, fd[1]);
+    }
+  }
+  close(fd[1]);
+  total = 0;
+  for(i = 0; i < nkid; i++)
+    if(read(fd[0], &n, sizeof(n)) == sizeof(n))
+      total += n;
+  for(i = 0; i < nkid; i++)
+    wait();
+  close(fd[0]);
+  printf(1, "%s: %d ticks, %d migrations\n", mode, uptime() - start, total);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int ncpu;
+
+  ncpu = ncpus();
+  printf(1, "affbench: %d cpus, %d processes, %dKB each\n",
+         ncpu, 2 * ncpu, WSET / 1024);
+  if(ncpu < 2)
+    printf(1, "affbench: run with CPUS=2 or more to see a difference\n");
+  run("pinned", ncpu);
+  run("free  ", ncpu);
+  run("bounce", ncpu);
+  exit();
+}
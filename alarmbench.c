@@ -0,0 +1,102 @@
+// Measure how closely a periodic interval timer keeps time. The
+// timer is armed for SIGALRM every period and each signal is taken
+// with sigwait(); we record the TSC cycles between arrivals against
+// the requested period, at whole-tick and sub-tick periods, and
+// the tick the last one arrived at against the tick requested. For
+// comparison, a sleep(PERIOD) loop doing the same work drifts by
+// the work time on every round.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "x86.h"
+
+#define NFIRE   100
+#define PERIOD  2       // ticks
+#define WORK    200000  // loop iterations of pretend work per round
+
+static volatile int sink;
+static uint cyclespertick;
+
+static void
+work(int n)
+{
+  int i;
+
+  for(i = 0; i < n; i++)
+    sink += i;
+}
+
+// TSC cycles per clock tick, timed over 10 ticks.
+static uint
+calibrate(void)
+{
+  uint t0;
+  int t;
+
+  t = uptime() + 1;
+  while(uptime() < t)
+    ;
+  t0 = rdtsc();
+  while(uptime() < t + 10)
+    ;
+  return (rdtsc() - t0) / 10;
+}
+
+// Take NFIRE SIGALRMs every period (in 1/ITIMERRES ticks).
+static void
+run(int period, int worksize)
+{
+  uint t0, t, gap, want, dev, sumdev, maxdev;
+  int i, start, end;
+
+  want = (uint)period * (cyclespertick / ITIMERRES);
+  sumdev = maxdev = 0;
+  start = uptime();
+  setitimer(period, period);
+  sigwait(1 << SIGALRM, 0);  // the first expiry only counts from a tick
+  t0 = rdtsc();
+  for(i = 0; i < NFIRE; i++){
+    if(sigwait(1 << SIGALRM, 0) != SIGALRM){
+      printf(2, "alarmbench: sigwait failed\n");
+      exit();
+    }
+    t = rdtsc();
+    gap = t - t0;
+    t0 = t;
+    dev = gap > want ? gap - want : want - gap;
+    sumdev += dev;
+    if(dev > maxdev)
+      maxdev = dev;
+    work(worksize);
+  }
+  end = uptime();
+  setitimer(0, 0);
+  printf(1, "setitimer every %d/%d ticks: jitter mean %d cycles, max %d"
+         " (period %d cycles); last at tick +%d, asked for +%d\n",
+         period, ITIMERRES, sumdev / NFIRE, maxdev, want,
+         end - start, (NFIRE + 1) * period / ITIMERRES);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, start, now;
+
+  cyclespertick = calibrate();
+  sigprocmask(1 << SIGALRM);
+  run(PERIOD * ITIMERRES, WORK);
+  run(ITIMERRES / 2, WORK / 10);
+  sigprocmask(0);
+
+  start = uptime();
+  for(i = 0; i < NFIRE; i++){
+    sleep(PERIOD);
+    work(WORK);
+  }
+  now = uptime();
+  printf(1, "sleep loop: %d rounds of %d ticks took %d ticks, drift %d\n",
+         NFIRE, PERIOD, now - start, now - start - NFIRE*PERIOD);
+  exit();
+}
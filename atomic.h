@@ -0,0 +1,69 @@
+// Atomic operations for user programs. All of them are full
+// memory barriers, as locked instructions are on x86.
+
+// If *addr == old, set it to new and return 1; else return 0.
+static inline int
+atomic_cas(volatile uint *addr, uint old, uint new)
+{
+  uchar ok;
+
+  asm volatile("lock; cmpxchgl %3, %1; sete %0"
+               : "=q" (ok), "+m" (*addr), "+a" (old)
+               : "r" (new)
+               : "memory");
+  return ok;
+}
+
+// 64-bit compare and swap of the two words at addr, which must
+// be 8-byte aligned: if they hold (oldlo, oldhi), replace them
+// with (newlo, newhi) and return 1; else return 0.
+static inline int
+atomic_cas2(volatile uint *addr, uint oldlo, uint oldhi, uint newlo, uint newhi)
+{
+  uchar ok;
+
+  asm volatile("lock; cmpxchg8b %1; sete %0"
+               : "=q" (ok), "+m" (*(volatile unsigned long long*)addr),
+                 "+a" (oldlo), "+d" (oldhi)
+               : "b" (newlo), "c" (newhi)
+               : "memory");
+  return ok;
+}
+
+// Add n to *addr and return its old value.
+static inline uint
+atomic_fetch_add(volatile uint *addr, int n)
+{
+  asm volatile("lock; xaddl %0, %1"
+               : "+r" (n), "+m" (*addr)
+               :
+               : "memory");
+  return n;
+}
+
+// Store v in *addr and return its old value.
+static inline uint
+atomic_xchg(volatile uint *addr, uint v)
+{
+  asm volatile("xchgl %0, %1"
+               : "+r" (v), "+m" (*addr)
+               :
+               : "memory");
+  return v;
+}
+
+// Tell the CPU we are in a spin loop, so it can save power and
+// not penalize the loop's exit with a memory-order flush.
+static inline void
+cpu_pause(void)
+{
+  asm volatile("pause" ::: "memory");
+}
+
+// Spin until *addr holds v.
+static inline void
+atomic_spin(volatile uint *addr, uint v)
+{
+  while(*addr != v)
+    cpu_pause();
+}
@@ -4,6 +4,7 @@ struct file;
 struct inode;
 struct pipe;
 struct proc;
+struct procinfo;
 struct rtcdate;
 struct spinlock;
 struct sleeplock;
@@ -78,6 +79,12 @@ int             lapicid(void);
 extern volatile uint*    lapic;
 void            lapiceoi(void);
 void            lapicinit(void);
+void            lapicipi(int, int);
+void            lapiconeshot(uint);
+int             lapicsubtick(int);
+void            lapicsubtickdone(void);
+void            lapictick(void);
+uint            lapicperiodic(void);
 void            lapicstartap(uchar, uint);
 void            microdelay(int);
 
@@ -106,28 +113,49 @@ int             pipewrite(struct pipe*, char*, int);
 int             cpuid(void);
 void            exit(void);
 int             fork(void);
+int             getprocinfo(struct procinfo*, int);
 int             growproc(int);
 int             kill(int,int);
+int             sendsig(struct proc*,int);
+int             sigqueue(int,int,int);
+int             sigqget(int*,int*);
+int             sigtimedwait(uint,int*,int);
 struct cpu*     mycpu(void);
 struct proc*    myproc();
 void            pinit(void);
 void            procdump(void);
 void            scheduler(void) __attribute__((noreturn));
 void            sched(void);
+int             schedtick(void);
+int             preemptpending(void);
 void            setproc(struct proc*);
 void            sleep(void*, struct spinlock*);
+void            sleepexcl(void*, struct spinlock*);
+int             sleepintr(void*, struct spinlock*, int);
 void            userinit(void);
 int             wait(void);
 void            wakeup(void*);
+void            wakeupone(void*);
 void            yield(void);
 //-----------------New SYSTEM CALLS----------------------------------------------------------------
 uint            sigprocmask(uint);
+int             sigaltstack(uint,uint);
 sighandler_t    signal(int,sighandler_t);
+int             setpriority(int,int);
+int             setscheduler(int,int,int);
+int             setaffinity(int,uint);
+int             getaffinity(int);
+int             setpgid(int,int);
+int             getpgid(int);
+int             clone(void(*)(void*,void*),void*,void*,void*);
+int             join(void**);
+int             futexwait(uint,uint);
+int             futexwake(uint,int);
 void            sigret(void);
 //-------------------------------------------------------------------------------------------------
 //-----------------Signal handlers-----------------------------------------------------------------
 void            default_handler(int);
-void            user_handler(int);
+int             user_handler(int,int);
 //-------------------------------------------------------------------------------------------------
 //-----------------Helper functions----------------------------------------------------------------
 uint            setBit(uint, int );
@@ -171,7 +199,11 @@ int             fetchstr(uint, char**);
 void            syscall(void);
 
 // timer.c
-void            timerinit(void);
+int             sleepticks(int);
+void            timeradvance(uint);
+uint            timernext(void);
+int             setitimer(int,int);
+void            timersubtick(void);
 
 // trap.c
 void            idtinit(void);
@@ -19,6 +19,10 @@ exec(char *path, char **argv)
   pde_t *pgdir, *oldpgdir;
   struct proc *curproc = myproc();
 
+  // Other threads would be left running in the old address space.
+  if(curproc->isthread || curproc->nthreads > 0)
+    return -1;
+
   begin_op();
 
   if((ip = namei(path)) == 0){
@@ -102,6 +106,8 @@ exec(char *path, char **argv)
         curproc->signal_handlers[i] = (void *)SIG_DFL;
   }
   //---------------END 2.1.2-----------------------------------------------------------------------
+  // The old signal stack is gone with the old image.
+  curproc->altstack = curproc->altsize = 0;
 
   // Commit to the user image.
   oldpgdir = curproc->pgdir;
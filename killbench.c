@@ -0,0 +1,75 @@
+// Measure how signal traffic scales with CPUs. For k = 1 up to
+// the number of CPUs, k processes, one pinned to each of CPUs
+// 0..k-1, kill() each other in a ring with an ignored signal for
+// DURATION ticks. Every kill() writes another CPU's process
+// (pending_signals) while that process is making system calls of
+// its own, so false sharing between hot and read-mostly fields of
+// struct proc shows up as per-CPU throughput falling as k grows.
+// Run with CPUS=8 to see the whole curve.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+
+#define DURATION 100
+#define SIGPOKE  16
+
+// Poke the previous worker (or ourselves, for the first) until
+// the deadline, then report the count.
+static void
+worker(int i, int *pids, uint start, int fd)
+{
+  uint n;
+  int target;
+
+  setaffinity(0, 1 << i);
+  target = i > 0 ? pids[i-1] : getpid();
+  while(uptime() < start)
+    ;
+  for(n = 0; uptime() < start + DURATION; n++)
+    kill(target, SIGPOKE);
+  write(fd, &n, sizeof(n));
+  exit();
+}
+
+static void
+run(int k)
+{
+  int fd[2], i, pids[NCPU];
+  uint start, total, n;
+
+  if(pipe(fd) < 0){
+    printf(2, "killbench: pipe failed\n");
+    exit();
+  }
+  start = uptime() + 5;  // let every worker get to its CPU first
+  for(i = 0; i < k; i++){
+    if((pids[i] = fork()) == 0){
+      close(fd[0]);
+      worker(i, pids, start, fd[1]);
+    }
+  }
+  close(fd[1]);
+  total = 0;
+  for(i = 0; i < k; i++)
+    if(read(fd[0], &n, sizeof(n)) == sizeof(n))
+      total += n;
+  for(i = 0; i < k; i++)
+    wait();
+  close(fd[0]);
+  printf(1, "%d cpus: %d kills/tick, %d per cpu\n",
+         k, total / DURATION, total / DURATION / k);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int k, ncpu;
+
+  signal(SIGPOKE, (sighandler_t)SIG_IGN);  // inherited by the workers
+  ncpu = ncpus();
+  for(k = 1; k <= ncpu; k++)
+    run(k);
+  exit();
+}
@@ -41,6 +41,9 @@
 #define TCCR    (0x0390/4)   // Timer Current Count
 #define TDCR    (0x03E0/4)   // Timer Divide Configuration
 
+#define TICKCOUNT 10000000            // timer counts per clock tick
+#define MAXONESHOT (0xFFFFFFFF / TICKCOUNT)  // longest one-shot, in ticks
+
 volatile uint *lapic;  // Initialized in mp.c
 
 //PAGEBREAK!
@@ -66,7 +69,7 @@ lapicinit(void)
   // TICR would be calibrated using an external time source.
   lapicw(TDCR, X1);
   lapicw(TIMER, PERIODIC | (T_IRQ0 + IRQ_TIMER));
-  lapicw(TICR, 10000000);
+  lapicw(TICR, TICKCOUNT);
 
   // Disable logical interrupt lines.
   lapicw(LINT0, MASKED);
@@ -113,6 +116,101 @@ lapiceoi(void)
     lapicw(EOI, 0);
 }
 
+// Sub-tick deadlines, CPU 0 only. In every timer mode used here
+// TCCR counts down to the next clock tick, so a deadline part way
+// through the tick is a count for TCCR to reach.
+static uint subleft;   // counts from the T_SUBTICK to the next tick
+static int finishing;  // counting subleft down in a one-shot
+
+// Interrupt with T_SUBTICK sub ITIMERRES units into the current
+// tick, then carry on to the next tick as usual. Returns -1 if
+// that point has already passed.
+int
+lapicsubtick(int sub)
+{
+  uint now, left;
+
+  if(!lapic)
+    return -1;
+  left = (ITIMERRES - sub) * (TICKCOUNT / ITIMERRES);
+  now = lapic[TCCR];
+  if(now <= left)
+    return -1;
+  lapicw(TIMER, T_SUBTICK);
+  lapicw(TICR, now - left);
+  subleft = left;
+  finishing = 0;
+  return 0;
+}
+
+// At T_SUBTICK: count down the rest of the tick.
+void
+lapicsubtickdone(void)
+{
+  if(!lapic)
+    return;
+  lapicw(TIMER, T_IRQ0 + IRQ_TIMER);
+  lapicw(TICR, subleft);
+  finishing = 1;
+}
+
+// At each clock tick on CPU 0: if it ended a sub-tick countdown,
+// go back to periodic ticks.
+void
+lapictick(void)
+{
+  if(!finishing)
+    return;
+  finishing = 0;
+  lapicw(TIMER, PERIODIC | (T_IRQ0 + IRQ_TIMER));
+  lapicw(TICR, TICKCOUNT);
+}
+
+// Stop this CPU's periodic clock tick and interrupt just once,
+// n ticks from now (or as late as the counter allows).
+void
+lapiconeshot(uint n)
+{
+  if(!lapic)
+    return;
+  if(n == 0 || n > MAXONESHOT)
+    n = MAXONESHOT;
+  if(cpuid() == 0)  // the sub-tick state is CPU 0's alone
+    finishing = 0;
+  lapicw(TIMER, T_IRQ0 + IRQ_TIMER);
+  lapicw(TICR, n * TICKCOUNT);
+}
+
+// Go back to periodic clock ticks after lapiconeshot().
+// Returns the number of whole ticks that passed meanwhile.
+uint
+lapicperiodic(void)
+{
+  uint elapsed;
+
+  if(!lapic)
+    return 0;
+  elapsed = (lapic[TICR] - lapic[TCCR]) / TICKCOUNT;
+  if(cpuid() == 0)
+    finishing = 0;
+  lapicw(TIMER, PERIODIC | (T_IRQ0 + IRQ_TIMER));
+  lapicw(TICR, TICKCOUNT);
+  return elapsed;
+}
+
+// Send a fixed-delivery interrupt with the given vector
+// to the CPU whose local APIC ID is apicid.
+void
+lapicipi(int apicid, int vector)
+{
+  if(!lapic)
+    return;
+  lapicw(ICRHI, apicid<<24);
+  lapicw(ICRLO, FIXED | ASSERT | vector);
+  while(lapic[ICRLO] & DELIVS)
+    ;
+}
+
 // Spin for a given number of microseconds.
 // On real hardware would want to tune this dynamically.
 void
@@ -0,0 +1,123 @@
+// Stress the lock-free queue and stack from lockfree.c with 1, 2,
+// ... up to one thread per CPU, checking that every item pushed
+// comes out exactly once, and report throughput for each count.
+// Threads share memory through clone(); run with different CPUS=
+// settings to see how the structures scale.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "atomic.h"
+#include "lockfree.h"
+
+#define NOPS    20000   // push/pop pairs per thread
+#define QSIZE   64
+#define NTHREADMAX 8
+
+struct item {
+  struct lfnode node;   // must be first, see stackworker
+  uint value;
+};
+
+static struct lfqueue queue;
+static struct lfstack stack;
+static struct item items[NTHREADMAX];
+static volatile uint pushed, popped;
+static volatile uint go;
+
+// Alternately push a value and pop whatever comes out.
+void
+queueworker(void *arg)
+{
+  uint i, base, in, out;
+  void *v;
+
+  base = (uint)arg * NOPS;
+  in = out = 0;
+  atomic_spin(&go, 1);
+  for(i = 1; i <= NOPS; i++){
+    while(lfq_push(&queue, (void*)(base + i)) < 0)
+      cpu_pause();
+    in += base + i;
+    while(lfq_pop(&queue, &v) < 0)
+      cpu_pause();
+    out += (uint)v;
+  }
+  atomic_fetch_add(&pushed, in);
+  atomic_fetch_add(&popped, out);
+}
+
+// Push one node and pop one, possibly another thread's, and keep
+// that for the next round, stamping it with a new value each time.
+void
+stackworker(void *arg)
+{
+  struct item *it;
+  uint i, base, in, out;
+
+  base = (uint)arg * NOPS;
+  it = &items[(uint)arg];
+  in = out = 0;
+  atomic_spin(&go, 1);
+  for(i = 1; i <= NOPS; i++){
+    it->value = base + i;
+    in += it->value;
+    lfs_push(&stack, &it->node);
+    while((it = (struct item*)lfs_pop(&stack)) == 0)
+      cpu_pause();
+    out += it->value;
+  }
+  atomic_fetch_add(&pushed, in);
+  atomic_fetch_add(&popped, out);
+}
+
+// Run nthread copies of fn, returning elapsed ticks, or -1 if
+// the items pushed and popped do not match.
+static int
+run(void (*fn)(void*), int nthread)
+{
+  int i;
+  uint start;
+
+  pushed = popped = go = 0;
+  for(i = 0; i < nthread; i++){
+    if(thread_create(fn, (void*)i) < 0){
+      printf(2, "lfbench: thread_create failed\n");
+      exit();
+    }
+  }
+  start = uptime();
+  go = 1;
+  while(thread_join() >= 0)
+    ;
+  if(pushed != popped)
+    return -1;
+  return uptime() - start;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int ncpu, n, qt, st;
+
+  ncpu = ncpus();
+  if(ncpu > NTHREADMAX)
+    ncpu = NTHREADMAX;
+  if(lfq_init(&queue, QSIZE) < 0){
+    printf(2, "lfbench: lfq_init failed\n");
+    exit();
+  }
+  lfs_init(&stack);
+  printf(1, "threads  queue ticks  stack ticks  (%d push/pop pairs each)\n", NOPS);
+  for(n = 1; n <= ncpu; n++){
+    qt = run(queueworker, n);
+    st = run(stackworker, n);
+    if(qt < 0 || st < 0){
+      printf(1, "lfbench: %s lost or duplicated items with %d threads\n",
+             qt < 0 ? "queue" : "stack", n);
+      exit();
+    }
+    printf(1, "%d        %d           %d\n", n, qt, st);
+  }
+  exit();
+}
@@ -0,0 +1,122 @@
+// Lock-free data structures built on the operations in atomic.h.
+
+#include "types.h"
+#include "user.h"
+#include "atomic.h"
+#include "lockfree.h"
+
+// The queue is an array of cells, each stamped with a sequence
+// number saying whose turn it is: a cell at position pos is free
+// for the producer of pos when seq == pos, and full for the
+// consumer of pos when seq == pos+1. Producers and consumers
+// claim positions by advancing tail and head with CAS, and hand
+// the cell over by bumping seq, so no two ever touch one cell.
+
+// Set up q with size cells; size must be a power of 2.
+// Returns 0, or -1 if size is bad or memory runs out.
+int
+lfq_init(struct lfqueue *q, uint size)
+{
+  uint i;
+
+  if(size == 0 || (size & (size - 1)) != 0)
+    return -1;
+  if((q->cells = malloc(size * sizeof(struct lfcell))) == 0)
+    return -1;
+  for(i = 0; i < size; i++)
+    q->cells[i].seq = i;
+  q->mask = size - 1;
+  q->head = 0;
+  q->tail = 0;
+  return 0;
+}
+
+// Append data. Returns 0, or -1 if the queue is full.
+int
+lfq_push(struct lfqueue *q, void *data)
+{
+  struct lfcell *c;
+  uint pos;
+  int diff;
+
+  pos = q->tail;
+  for(;;){
+    c = &q->cells[pos & q->mask];
+    diff = (int)(c->seq - pos);
+    if(diff == 0){
+      if(atomic_cas(&q->tail, pos, pos + 1))
+        break;
+    } else if(diff < 0)
+      return -1;
+    pos = q->tail;
+  }
+  c->data = data;
+  c->seq = pos + 1;
+  return 0;
+}
+
+// Remove the oldest item into *data. Returns 0, or -1 if the
+// queue is empty.
+int
+lfq_pop(struct lfqueue *q, void **data)
+{
+  struct lfcell *c;
+  uint pos;
+  int diff;
+
+  pos = q->head;
+  for(;;){
+    c = &q->cells[pos & q->mask];
+    diff = (int)(c->seq - (pos + 1));
+    if(diff == 0){
+      if(atomic_cas(&q->head, pos, pos + 1))
+        break;
+    } else if(diff < 0)
+      return -1;
+    pos = q->head;
+  }
+  *data = c->data;
+  c->seq = pos + q->mask + 1;
+  return 0;
+}
+
+// The stack swaps top together with a count of pops, so a pop
+// that read top == A and A->next == B fails if A was popped and
+// pushed back meanwhile. Nodes may still be read after another
+// thread has popped them, so they must stay mapped: never shrink
+// memory that once held nodes.
+
+void
+lfs_init(struct lfstack *s)
+{
+  s->top = 0;
+  s->npop = 0;
+}
+
+void
+lfs_push(struct lfstack *s, struct lfnode *n)
+{
+  struct lfnode *top;
+
+  do{
+    top = s->top;
+    n->next = top;
+  } while(!atomic_cas((volatile uint*)&s->top, (uint)top, (uint)n));
+}
+
+// Returns the most recently pushed node, or 0 if s is empty.
+struct lfnode*
+lfs_pop(struct lfstack *s)
+{
+  struct lfnode *top;
+  uint npop;
+
+  do{
+    npop = s->npop;
+    top = s->top;
+    if(top == 0)
+      return 0;
+  } while(!atomic_cas2((volatile uint*)s, (uint)top, npop,
+                       (uint)top->next, npop + 1));
+  return top;
+}
@@ -0,0 +1,36 @@
+// Lock-free data structures for threads sharing memory.
+// See lockfree.c.
+
+// Bounded multi-producer, multi-consumer FIFO queue.
+struct lfcell {
+  volatile uint seq;
+  void * volatile data;
+};
+
+struct lfqueue {
+  struct lfcell *cells;
+  uint mask;                        // number of cells - 1
+  char pad0[56];
+  volatile uint head;               // next cell to dequeue
+  char pad1[60];
+  volatile uint tail;               // next cell to enqueue
+  char pad2[60];
+};
+
+int lfq_init(struct lfqueue*, uint size);
+int lfq_push(struct lfqueue*, void *data);
+int lfq_pop(struct lfqueue*, void **data);
+
+// Treiber stack of caller-allocated nodes.
+struct lfnode {
+  struct lfnode *next;
+};
+
+struct lfstack {
+  struct lfnode * volatile top;
+  volatile uint npop;               // ABA tag, bumped by each pop
+} __attribute__((aligned(8)));
+
+void lfs_init(struct lfstack*);
+void lfs_push(struct lfstack*, struct lfnode*);
+struct lfnode *lfs_pop(struct lfstack*);
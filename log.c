@@ -122,18 +122,22 @@ recover_from_log(void)
 }
 
 // called at the start of each FS system call.
+// Waiters sleep exclusively; each one that gets in wakes
+// the next, so a commit admits waiters one at a time
+// instead of waking all of them to fight over log space.
 void
 begin_op(void)
 {
   acquire(&log.lock);
   while(1){
     if(log.committing){
-      sleep(&log, &log.lock);
+      sleepexcl(&log, &log.lock);
     } else if(log.lh.n + (log.outstanding+1)*MAXOPBLOCKS > LOGSIZE){
       // this op might exhaust log space; wait for commit.
-      sleep(&log, &log.lock);
+      sleepexcl(&log, &log.lock);
     } else {
       log.outstanding += 1;
+      wakeupone(&log);
       release(&log.lock);
       break;
     }
@@ -158,7 +162,7 @@ end_op(void)
     // begin_op() may be waiting for log space,
     // and decrementing log.outstanding has decreased
     // the amount of reserved space.
-    wakeup(&log);
+    wakeupone(&log);
   }
   release(&log.lock);
 
@@ -168,7 +172,7 @@ end_op(void)
     commit();
     acquire(&log.lock);
     log.committing = 0;
-    wakeup(&log);
+    wakeupone(&log);
     release(&log.lock);
   }
 }
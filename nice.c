@@ -0,0 +1,30 @@
+// Run a command at a different scheduling priority.
+// nice n cmd [args...], with n from -20 (favoured) to 19.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+int
+main(int argc, char *argv[])
+{
+  int n;
+  char *s;
+
+  if(argc < 3){
+    printf(2, "usage: nice n cmd [args...]\n");
+    exit();
+  }
+
+  s = argv[1];
+  n = atoi(*s == '-' ? s+1 : s);
+  if(*s == '-')
+    n = -n;
+  if(setpriority(0, n) < 0){
+    printf(2, "nice: bad nice value %s\n", argv[1]);
+    exit();
+  }
+  exec(argv[2], argv+2);
+  printf(2, "nice: exec %s failed\n", argv[2]);
+  exit();
+}
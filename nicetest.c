@@ -0,0 +1,84 @@
+// Measure the CPU share each nice level gets. Every child spins
+// for the same wall-clock period at its own nice value and reports
+// how much work it got done. Run with CPUS=1 so that all children
+// compete for the same CPU.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+#define NRUN 300   // ticks each child spins for
+
+static int nices[]   = { -5,   0,    5,   10 };
+static int weights[] = { 3121, 1024, 335, 110 };  // see niceweight in proc.c
+#define NCHILD (sizeof(nices)/sizeof(nices[0]))
+
+struct result {
+  int child;
+  uint work;
+};
+
+void
+spin(int child, int start, int fd)
+{
+  struct result r;
+  volatile int i;
+
+  setpriority(0, nices[child]);
+  while(uptime() < start)
+    ;
+  r.child = child;
+  r.work = 0;
+  while(uptime() < start + NRUN){
+    for(i = 0; i < 1000; i++)
+      ;
+    r.work++;
+  }
+  write(fd, &r, sizeof(r));
+  exit();
+}
+
+int
+main(int argc, char *argv[])
+{
+  int fds[2], i, start, wsum;
+  uint work[NCHILD], total;
+  struct result r;
+
+  if(pipe(fds) < 0){
+    printf(2, "nicetest: pipe failed\n");
+    exit();
+  }
+
+  start = uptime() + 10;
+  for(i = 0; i < NCHILD; i++){
+    if(fork() == 0){
+      close(fds[0]);
+      spin(i, start, fds[1]);
+    }
+  }
+  close(fds[1]);
+
+  total = 0;
+  for(i = 0; i < NCHILD; i++)
+    work[i] = 0;
+  while(read(fds[0], &r, sizeof(r)) == sizeof(r)){
+    work[r.child] = r.work;
+    total += r.work;
+  }
+  for(i = 0; i < NCHILD; i++)
+    wait();
+
+  if(total == 0){
+    printf(2, "nicetest: no work reported\n");
+    exit();
+  }
+  wsum = 0;
+  for(i = 0; i < NCHILD; i++)
+    wsum += weights[i];
+  printf(1, "nice  weight  expected%%  measured%%\n");
+  for(i = 0; i < NCHILD; i++)
+    printf(1, "%d\t%d\t%d\t\t%d\n", nices[i], weights[i],
+           weights[i] * 100 / wsum, work[i] * 100 / total);
+  exit();
+}
@@ -10,14 +10,25 @@
 #define MAXOPBLOCKS  10  // max # of blocks any FS op writes
 #define LOGSIZE      (MAXOPBLOCKS*3)  // max data blocks in on-disk log
 #define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
-#define FSSIZE       1000  // size of file system in blocks
+#define FSSIZE       2000  // size of file system in blocks
+#define CACHELINE    64  // bytes per cache line, for padding hot data
 
 //-----------------Definitions of Task 2.1.1-------------------------------------------------------
 #define SIG_DFL     -1
 #define SIG_IGN      1
 
 #define SIG_KILL     9
+#define SIGALRM      14  // interval timer expired, see setitimer()
+#define ITIMERRES    100 // setitimer() time units per clock tick
 #define SIGSTOP      17
 #define SIGCONT      19
+#define SIGRTMIN     24  // real-time signals queue, see sigqueue()
+#define SIGRTMAX     31
+#define NSIGQ        32  // queued real-time signals per process, power of 2
+#define MINSIGSTKSZ  256 // smallest sigaltstack(): a signal frame and some
+
+#define SCHED_OTHER  0   // fair share, weighted by nice value
+#define SCHED_FIFO   1   // real-time, preempts SCHED_OTHER
+#define RTPRIO_MAX   99
 //-----------------END OF DEFINITIONS--------------------------------------------------------------
 
@@ -75,6 +75,9 @@ pipeclose(struct pipe *p, int writable)
 }
 
 //PAGEBREAK: 40
+// Readers and writers sleep as exclusive waiters, so each wakeup
+// rouses a single process. One that leaves data (or space) behind
+// passes the wakeup on to the next waiter.
 int
 pipewrite(struct pipe *p, char *addr, int n)
 {
@@ -87,12 +90,21 @@ pipewrite(struct pipe *p, char *addr, int n)
         release(&p->lock);
         return -1;
       }
-      wakeup(&p->nread);
-      sleep(&p->nwrite, &p->lock);  //DOC: pipewrite-sleep
+      wakeupone(&p->nread);
+      if(sleepintr(&p->nwrite, &p->lock, 1) < 0){  //DOC: pipewrite-sleep
+        // Pass on any wakeup meant for us, and report what
+        // was written before the signal.
+        if(p->nwrite != p->nread + PIPESIZE)
+          wakeupone(&p->nwrite);
+        release(&p->lock);
+        return i > 0 ? i : -1;
+      }
     }
     p->data[p->nwrite++ % PIPESIZE] = addr[i];
   }
-  wakeup(&p->nread);  //DOC: pipewrite-wakeup1
+  wakeupone(&p->nread);  //DOC: pipewrite-wakeup1
+  if(p->nwrite != p->nread + PIPESIZE)
+    wakeupone(&p->nwrite);
   release(&p->lock);
   return n;
 }
@@ -108,14 +120,22 @@ piperead(struct pipe *p, char *addr, int n)
       release(&p->lock);
       return -1;
     }
-    sleep(&p->nread, &p->lock); //DOC: piperead-sleep
+    if(sleepintr(&p->nread, &p->lock, 1) < 0){ //DOC: piperead-sleep
+      // Pass on any wakeup meant for us.
+      if(p->nread != p->nwrite)
+        wakeupone(&p->nread);
+      release(&p->lock);
+      return -1;
+    }
   }
   for(i = 0; i < n; i++){  //DOC: piperead-copy
     if(p->nread == p->nwrite)
       break;
     addr[i] = p->data[p->nread++ % PIPESIZE];
   }
-  wakeup(&p->nwrite);  //DOC: piperead-wakeup
+  wakeupone(&p->nwrite);  //DOC: piperead-wakeup
+  if(p->nread != p->nwrite)
+    wakeupone(&p->nread);
   release(&p->lock);
   return i;
 }
@@ -0,0 +1,88 @@
+// Many readers blocked on one pipe, fed by a single writer.
+// With wake-all pipes every write woke all the readers and all
+// but one went straight back to sleep; with exclusive waiters
+// each write wakes one reader. Reports elapsed ticks and the
+// context switches the readers took between them.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "procinfo.h"
+
+#define NREADER 16
+#define NMSG    2000
+#define MSGSZ   8
+
+struct procinfo info[NPROC];
+
+// Number of times this process has been dispatched.
+uint
+myswitches(void)
+{
+  int i, n, pid;
+
+  pid = getpid();
+  n = getprocinfo(info, NPROC);
+  for(i = 0; i < n; i++)
+    if(info[i].pid == pid)
+      return info[i].nswitch;
+  return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int fds[2], res[2], i, pid, nreader, start;
+  uint nswitch, total;
+  char buf[MSGSZ];
+
+  nreader = NREADER;
+  if(argc > 1)
+    nreader = atoi(argv[1]);
+
+  if(pipe(fds) < 0 || pipe(res) < 0){
+    printf(2, "pipebench: pipe failed\n");
+    exit();
+  }
+
+  for(i = 0; i < nreader; i++){
+    pid = fork();
+    if(pid < 0){
+      printf(2, "pipebench: fork failed\n");
+      nreader = i;
+      break;
+    }
+    if(pid == 0){
+      close(fds[1]);
+      close(res[0]);
+      while(read(fds[0], buf, sizeof(buf)) > 0)
+        ;
+      nswitch = myswitches();
+      write(res[1], &nswitch, sizeof(nswitch));
+      exit();
+    }
+  }
+  close(fds[0]);
+  close(res[1]);
+
+  start = uptime();
+  memset(buf, 'x', sizeof(buf));
+  for(i = 0; i < NMSG; i++){
+    if(write(fds[1], buf, sizeof(buf)) != sizeof(buf)){
+      printf(2, "pipebench: write failed\n");
+      break;
+    }
+  }
+  close(fds[1]);
+  total = 0;
+  while(read(res[0], &nswitch, sizeof(nswitch)) == sizeof(nswitch))
+    total += nswitch;
+  for(i = 0; i < nreader; i++)
+    wait();
+
+  printf(1, "pipebench: %d readers, %d writes of %d bytes: %d ticks, "
+         "%d reader context switches\n",
+         nreader, NMSG, MSGSZ, uptime() - start, total);
+  exit();
+}
@@ -4,7 +4,9 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "x86.h"
+#include "traps.h"
 #include "proc.h"
+#include "procinfo.h"
 #include "spinlock.h"
 
 struct {
@@ -12,20 +14,86 @@ struct {
   struct proc proc[NPROC];
 } ptable;
 
+// Per-CPU run queues. A process sits on exactly one queue while it
+// is RUNNABLE, so scheduler() picks the next process in O(1) instead
+// of CASing every ptable slot. A CPU whose own queue is empty steals
+// from the longest sibling queue.
+//
+// A process only ever runs on the CPUs in its affinity mask. It is
+// queued on the CPU it last ran on, whose caches and TLB are most
+// likely to still hold its working set, and is stolen by another
+// CPU only when that one would otherwise sit idle.
+//
+// Real-time (SCHED_FIFO) processes sort ahead of everything else,
+// highest rtprio first. Normal processes follow, sorted by virtual
+// runtime: the CPU time a process has used, scaled down by its
+// weight (see niceweight), so the head is always the process
+// furthest behind its fair share.
+struct runq {
+  struct spinlock lock;
+  struct proc *head;
+  int len;
+  uint minvruntime;  // vruntime of the most recently dispatched process
+};
+
+static struct runq runqs[NCPU];
+
+// Weight of each nice level, from -20 to 19. Each step is worth
+// about 10% of CPU time relative to a neighbouring level.
+static int niceweight[40] = {
+  88761, 71755, 56483, 46273, 36291,
+  29154, 23254, 18705, 14949, 11916,
+   9548,  7620,  6100,  4904,  3906,
+   3121,  2501,  1991,  1586,  1277,
+   1024,   820,   655,   526,   423,
+    335,   272,   215,   172,   137,
+    110,    87,    70,    56,    45,
+     36,    29,    23,    18,    15,
+};
+
+// vruntime charged to a nice 0 process for one timer tick.
+#define TICKVRUNTIME 1024
+
+// Sleeping processes are hashed by chan into wait queues, so
+// wakeup() only touches the sleepers that share chan's bucket.
+#define WAITQSHIFT 6
+#define NWAITQ     (1 << WAITQSHIFT)
+#define WAITQ(chan) (&waitqs[((uint)(chan) * 2654435761U) >> (32 - WAITQSHIFT)])
+
+struct waitq {
+  struct spinlock lock;
+  struct proc *head;
+};
+
+static struct waitq waitqs[NWAITQ];
+
 static struct proc *initproc;
 
+// Serializes growproc(), so that threads sharing an address
+// space cannot resize it at the same time.
+static struct spinlock growlock;
+
 int nextpid = 1;
 extern void forkret(void);
 extern void trapret(void);
-extern void call_sigret(void);
-extern void call_sigret_end(void);
 
-static void wakeup1(void *chan);
+static void wakeup1(void *chan, int one);
+static struct proc *findproc(int pid);
+static int reap(int threads, void **stack, int killable);
+static int sigqput(struct proc *p, int signum, int value);
+static void contproc(struct proc *p);
 
 void
 pinit(void)
 {
+  int i;
+
   initlock(&ptable.lock, "ptable");
+  for(i = 0; i < NCPU; i++)
+    initlock(&runqs[i].lock, "runq");
+  for(i = 0; i < NWAITQ; i++)
+    initlock(&waitqs[i].lock, "waitq");
+  initlock(&growlock, "grow");
 }
 
 // Must be called with interrupts disabled
@@ -66,6 +134,516 @@ myproc(void) {
   popcli();
   return p;
 }
+//PAGEBREAK!
+// Does p belong ahead of q on a run queue? Real-time processes of
+// equal priority keep FIFO order and never preempt one another.
+static int
+runsbefore(struct proc *p, struct proc *q)
+{
+  if(p->rtprio != q->rtprio)
+    return p->rtprio > q->rtprio;
+  if(p->rtprio > 0)
+    return 0;
+  return (int)(p->vruntime - q->vruntime) < 0;
+}
+
+// Insert p into rq behind every process that runs before it or
+// ties with it. A normal process returning from a long sleep is
+// brought up to the queue's current vruntime so it cannot
+// monopolize the CPU.
+static void
+runqput(struct runq *rq, struct proc *p)
+{
+  struct proc **pp;
+
+  acquire(&rq->lock);
+  if(p->rtprio == 0 && (int)(p->vruntime - rq->minvruntime) < 0)
+    p->vruntime = rq->minvruntime;
+  for(pp = &rq->head; *pp; pp = &(*pp)->rqnext)
+    if(runsbefore(p, *pp))
+      break;
+  p->rqnext = *pp;
+  *pp = p;
+  rq->len++;
+  release(&rq->lock);
+}
+
+// Remove and return the first process on rq that may run on
+// CPU id, or 0 if there is none.
+static struct proc*
+runqget(struct runq *rq, int id)
+{
+  struct proc *p, **pp;
+
+  if(rq->len == 0)
+    return 0;
+  acquire(&rq->lock);
+  for(pp = &rq->head; (p = *pp) != 0; pp = &p->rqnext)
+    if(p->affinity & (1 << id))
+      break;
+  if(p){
+    *pp = p->rqnext;
+    p->rqnext = 0;
+    rq->len--;
+    if(p->rtprio == 0 && (int)(p->vruntime - rq->minvruntime) > 0)
+      rq->minvruntime = p->vruntime;
+  }
+  release(&rq->lock);
+  return p;
+}
+
+// Take p off rq if it is there. Returns 1 if it was.
+static int
+runqremove(struct runq *rq, struct proc *p)
+{
+  struct proc **pp;
+  int found;
+
+  if(rq->len == 0)
+    return 0;
+  acquire(&rq->lock);
+  for(pp = &rq->head; *pp; pp = &(*pp)->rqnext)
+    if(*pp == p)
+      break;
+  found = *pp != 0;
+  if(found){
+    *pp = p->rqnext;
+    p->rqnext = 0;
+    rq->len--;
+  }
+  release(&rq->lock);
+  return found;
+}
+
+// Does rq hold a process that may run on CPU id?
+static int
+runqhas(struct runq *rq, int id)
+{
+  struct proc *p;
+
+  if(rq->len == 0)
+    return 0;
+  acquire(&rq->lock);
+  for(p = rq->head; p; p = p->rqnext)
+    if(p->affinity & (1 << id))
+      break;
+  release(&rq->lock);
+  return p != 0;
+}
+
+// The CPU whose queue p should join: the one it last ran on if
+// its mask still allows it, else this one, else the first allowed.
+static int
+homecpu(struct proc *p)
+{
+  int id;
+
+  if(p->lastcpu >= 0 && (p->affinity & (1 << p->lastcpu)))
+    return p->lastcpu;
+  id = cpuid();
+  if(p->affinity & (1 << id))
+    return id;
+  for(id = 0; id < ncpu; id++)
+    if(p->affinity & (1 << id))
+      break;
+  return id;
+}
+
+// Queue p, which the caller has just moved to RUNNABLE, on its
+// home CPU's run queue (see homecpu). If that CPU is halted, wake
+// it; otherwise wake one halted CPU that p may run on to come and
+// steal it. Must be called with interrupts disabled.
+static void
+setrunnable(struct proc *p)
+{
+  struct cpu *c, *home;
+  int id;
+
+  id = homecpu(p);
+  home = &cpus[id];
+  p->readytick = ticks;
+  runqput(&runqs[id], p);
+  // A real-time process preempts a normal one running there as
+  // soon as that one next leaves the kernel (see trap).
+  if(p->rtprio > 0 && home->proc && runsbefore(p, home->proc)){
+    home->resched = 1;
+    if(home != mycpu())
+      lapicipi(home->apicid, T_RESCHED);
+  }
+  if(home != mycpu() && home->idle && cas(&home->idle, 1, 0)){
+    lapicipi(home->apicid, T_RESCHED);
+    return;
+  }
+  for(c = cpus; c < cpus+ncpu; c++){
+    if(c != home && c != mycpu() && (p->affinity & (1 << (c - cpus))) &&
+       c->idle && cas(&c->idle, 1, 0)){
+      lapicipi(c->apicid, T_RESCHED);
+      break;
+    }
+  }
+}
+
+// Halt this CPU until an interrupt arrives, unless a process
+// became runnable meanwhile. c->idle is raised before the run
+// queues are checked, so a setrunnable() racing with us either
+// shows up in the check or sees the flag and sends an IPI.
+//
+// A halted CPU also stops its periodic clock tick. CPUs other than
+// 0 need no tick until an IPI wakes them. CPU 0 keeps time, so it
+// arms a one-shot for the next sleep() deadline, and only when all
+// the others are idle too. Another CPU can still be woken by a
+// device interrupt (the disk's goes to the last CPU) and start
+// work that needs the clock, so any CPU leaving idle kicks CPU 0
+// out of its one-shot. CPU 0 raises oneshot before looking at the
+// others' idle flags, and they clear idle before looking at
+// oneshot, so one side always sees the other. Ticks that passed
+// while the timer was off are made up afterwards.
+static void
+cpuidle(struct cpu *c)
+{
+  int i;
+  uint n, taken, elapsed;
+
+  cli();
+  xchg((volatile uint*)&c->idle, 1);
+  for(i = 0; i < ncpu; i++)
+    if(runqhas(&runqs[i], c - cpus))
+      break;
+  if(i == ncpu){
+    n = 0;
+    if(c == &cpus[0]){
+      xchg((volatile uint*)&c->oneshot, 1);
+      for(i = 1; i < ncpu; i++)
+        if(!cpus[i].idle)
+          break;
+      n = i < ncpu ? 1 : timernext();
+    }
+    if(n == 1){
+      c->oneshot = 0;
+      stihlt();
+    } else {
+      taken = c->nticks;
+      lapiconeshot(n);
+      stihlt();
+      cli();
+      elapsed = lapicperiodic();
+      c->oneshot = 0;
+      taken = c->nticks - taken;
+      if(elapsed > taken){
+        elapsed -= taken;
+        c->nticks += elapsed;
+        c->idleticks += elapsed;
+        if(c == &cpus[0])
+          timeradvance(elapsed);
+      }
+    }
+  }
+  c->oneshot = 0;
+  xchg((volatile uint*)&c->idle, 0);
+  if(c != &cpus[0] && cpus[0].oneshot && cas(&cpus[0].oneshot, 1, 0))
+    lapicipi(cpus[0].apicid, T_RESCHED);
+  sti();
+}
+
+// Choose the next process for this CPU: the head of its own queue,
+// or else one stolen from a sibling, busiest first, that this
+// CPU is allowed to run.
+// Must be called with interrupts disabled.
+static struct proc*
+pickproc(void)
+{
+  struct proc *p;
+  int i, id, victim, len, tried;
+
+  id = cpuid();
+  if((p = runqget(&runqs[id], id)) != 0)
+    return p;
+
+  tried = 1 << id;
+  for(;;){
+    victim = -1;
+    len = 0;
+    for(i = 0; i < ncpu; i++){
+      if(!(tried & (1 << i)) && runqs[i].len > len){
+        victim = i;
+        len = runqs[i].len;
+      }
+    }
+    if(victim < 0)
+      return 0;
+    if((p = runqget(&runqs[victim], id)) != 0)
+      return p;
+    tried |= 1 << victim;
+  }
+}
+
+// Charge the current process for a timer tick of CPU time.
+// Returns 1 if it should yield to a process on this CPU's
+// run queue that runs before it.
+int
+schedtick(void)
+{
+  struct proc *p;
+  struct runq *rq;
+  int resched;
+
+  pushcli();
+  p = myproc();
+  if(p->rtprio == 0)
+    p->vruntime += TICKVRUNTIME * niceweight[20] / niceweight[p->nice + 20];
+  rq = &runqs[cpuid()];
+  resched = 0;
+  if(rq->len > 0){
+    acquire(&rq->lock);
+    resched = rq->head && runsbefore(rq->head, p);
+    release(&rq->lock);
+  }
+  popcli();
+  return resched;
+}
+
+// Returns 1, once, if a real-time process has been queued on this
+// CPU since the current process was dispatched (see setrunnable).
+int
+preemptpending(void)
+{
+  int r;
+
+  pushcli();
+  r = mycpu()->resched;
+  mycpu()->resched = 0;
+  popcli();
+  return r;
+}
+
+// Flags for sleepon().
+#define WQEXCL 1  // exclusive waiter, see sleepexcl
+#define WQINTR 2  // interruptible: sendsig() wakes it, see sleepintr
+
+// Put the running process p on chan's wait queue and mark it
+// NEG_SLEEPING. Exclusive waiters queue FIFO at the tail, behind
+// the wake-all ones. The caller must then either sched() or, if it
+// changes its mind while still on its CPU, call cancelsleep().
+static void
+sleepon(struct proc *p, void *chan, int flags)
+{
+  struct waitq *wq = WAITQ(chan);
+  struct proc **pp;
+
+  acquire(&wq->lock);
+  p->chan = chan;
+  p->wqexcl = (flags & WQEXCL) != 0;
+  p->wqintr = (flags & WQINTR) != 0;
+  if(p->wqexcl){
+    for(pp = &wq->head; *pp; pp = &(*pp)->wqnext)
+      ;
+    p->wqnext = 0;
+    *pp = p;
+  } else {
+    p->wqnext = wq->head;
+    wq->head = p;
+  }
+  if(!cas(&p->state, RUNNING, NEG_SLEEPING))
+    panic("sleepon: not running");
+  release(&wq->lock);
+}
+
+// Wake p, which the caller has just unlinked from its wait queue.
+// A process that has not yet left its CPU goes to NEG_RUNNABLE and
+// scheduler() queues it once swtch() has saved its context.
+// The wait queue lock must be held.
+static void
+wakeproc(struct proc *p)
+{
+  p->chan = 0;
+  for(;;){
+    if(cas(&p->state, NEG_SLEEPING, NEG_RUNNABLE))
+      return;
+    if(cas(&p->state, SLEEPING, RUNNABLE)){
+      setrunnable(p);
+      return;
+    }
+  }
+}
+
+// Remove p from chan's wait queue if it is still there.
+// Returns 1 if p was found. The wait queue lock must be held.
+static int
+unlinkwaiter(struct waitq *wq, struct proc *p)
+{
+  struct proc **pp;
+
+  for(pp = &wq->head; *pp; pp = &(*pp)->wqnext){
+    if(*pp == p){
+      *pp = p->wqnext;
+      p->wqnext = 0;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Undo sleepon() for the current process, which never reached
+// sched(). A wakeup may already have moved it to NEG_RUNNABLE.
+static void
+cancelsleep(struct proc *p, void *chan)
+{
+  struct waitq *wq = WAITQ(chan);
+
+  acquire(&wq->lock);
+  unlinkwaiter(wq, p);
+  p->chan = 0;
+  if(!cas(&p->state, NEG_SLEEPING, RUNNING) && !cas(&p->state, NEG_RUNNABLE, RUNNING))
+    panic("cancelsleep");
+  release(&wq->lock);
+}
+
+// Wake p if it is asleep, whatever channel it sleeps on.
+// Must be called with interrupts disabled.
+static void
+wakesleeper(struct proc *p)
+{
+  void *chan = p->chan;
+  struct waitq *wq;
+
+  if(chan == 0)
+    return;
+  wq = WAITQ(chan);
+  acquire(&wq->lock);
+  if(p->chan == chan && unlinkwaiter(wq, p))
+    wakeproc(p);
+  release(&wq->lock);
+}
+
+// Has the current process been told to carry on after SIGSTOP?
+static int
+stopover(struct proc *p)
+{
+  return isBitOn(p->pending_signals, SIGCONT) ||
+         isBitOn(p->pending_signals, SIG_KILL) || p->killed;
+}
+
+// Stop the current process until SIGCONT (or SIG_KILL) arrives.
+// A stopped process is on no run queue, so the scheduler never
+// sees it. As with sleep, it goes NEG_STOPPED before checking for
+// SIGCONT, and sendsig() posts SIGCONT before looking at its state,
+// so one of the two always notices the other.
+static void
+stopproc(void)
+{
+  struct proc *p = myproc();
+
+  pushcli();
+  while(!stopover(p)){
+    if(!cas(&p->state, RUNNING, NEG_STOPPED))
+      panic("stopproc: not running");
+    if(stopover(p)){
+      // SIGCONT raced with us; contproc() may have seen us too.
+      if(!cas(&p->state, NEG_STOPPED, RUNNING) && !cas(&p->state, NEG_RUNNABLE, RUNNING))
+        panic("stopproc");
+      break;
+    }
+    sched();
+  }
+  popcli();
+}
+
+// Make p runnable again if it is stopped.
+static void
+contproc(struct proc *p)
+{
+  for(;;){
+    if(cas(&p->state, NEG_STOPPED, NEG_RUNNABLE))
+      return;
+    if(cas(&p->state, STOPPED, RUNNABLE)){
+      setrunnable(p);
+      return;
+    }
+    if(p->state != STOPPED && p->state != NEG_STOPPED)
+      return;
+  }
+}
+
+// Would signum, if pending, make p do something on its way back
+// to user space, or end its sigtimedwait()? Masked and ignored
+// signals would not, nor would SIGCONT with its default action.
+static int
+wantsig(struct proc *p, int signum)
+{
+  void *h = p->signal_handlers[signum];
+
+  if(isBitOn(p->sigwaitmask, signum))
+    return 1;
+  if(isBitOn(p->signal_mask, signum) || h == (void*)SIG_IGN)
+    return 0;
+  return signum != SIGCONT || h != (void*)SIG_DFL;
+}
+
+// Should an interruptible sleep by p end early?
+static int
+interrupted(struct proc *p)
+{
+  uint todo, pos;
+  struct sigqent *e;
+
+  if(p->killed)
+    return 1;
+  for(todo = p->pending_signals; todo != 0; todo &= todo - 1)
+    if(wantsig(p, bsf(todo)))
+      return 1;
+  pos = p->sigqhead;
+  e = &p->sigq[pos % NSIGQ];
+  return e->seq == pos + 1 && wantsig(p, e->signum);
+}
+
+// Wake p if it is in an interruptible sleep. The caller has just
+// posted a signal; p checks for signals after going NEG_SLEEPING,
+// so either it sees the signal or we see it asleep here.
+static void
+wakeintr(struct proc *p)
+{
+  void *chan = p->chan;
+  struct waitq *wq;
+
+  if(chan == 0)
+    return;
+  wq = WAITQ(chan);
+  acquire(&wq->lock);
+  if(p->chan == chan && p->wqintr && unlinkwaiter(wq, p))
+    wakeproc(p);
+  release(&wq->lock);
+}
+
+// Push the chain head..tail of children onto parent's child list.
+// Only a process's own wait() removes entries from its list, and
+// pushes only ever touch the list head, so a CAS on it suffices.
+static void
+addchildren(struct proc *parent, struct proc *head, struct proc *tail)
+{
+  struct proc *first;
+
+  do{
+    first = parent->children;
+    tail->sibling = first;
+  } while(!cas(&parent->children, (int)first, (int)head));
+}
+
+// Unlink p from parent's child list. Must be called by parent.
+static void
+removechild(struct proc *parent, struct proc *p)
+{
+  struct proc *q;
+
+  // If a push raced us, p is no longer the head and its new
+  // predecessor was linked to it before the push took effect.
+  if(!cas(&parent->children, (int)p, (int)p->sibling)){
+    for(q = parent->children; q->sibling != p; q = q->sibling)
+      ;
+    q->sibling = p->sibling;
+  }
+  p->sibling = 0;
+}
+
 //-----------------New function section------------------------------------------------------------
 //=================HELPER FUNCTIONS================================================================
 uint setBit(uint bits_arr, int bit){
@@ -97,17 +675,199 @@ sighandler_t signal(int signum, sighandler_t handler)
     struct proc *p = myproc();
     pushcli();
     sighandler_t old_one = p->signal_handlers[signum];
-    p->signal_handlers[signum] = handler;
+    struct proc *q;
+    // Threads share their handlers.
+    for(q = ptable.proc; q < &ptable.proc[NPROC]; q++)
+        if(q->state != UNUSED && q->pgdir == p->pgdir)
+            q->signal_handlers[signum] = handler;
     popcli();
     return old_one;
 }
 
+// Put process pid (0 for the caller), which must be the caller or
+// one of its children, in process group pgid (0 for a new group
+// named after pid). Joining a group that does not exist yet is
+// allowed only by making a new one.
+int setpgid(int pid, int pgid)
+{
+    struct proc *p, *q;
+    struct proc *curproc = myproc();
+
+    if(pgid < 0)
+        return -1;
+    pushcli();
+    p = pid == 0 ? curproc : findproc(pid);
+    if(p == 0 || (p != curproc && p->parent != curproc) || p->state == ZOMBIE){
+        popcli();
+        return -1;
+    }
+    if(pgid == 0)
+        pgid = p->pid;
+    if(pgid != p->pid){
+        for(q = ptable.proc; q < &ptable.proc[NPROC]; q++)
+            if(q->pgid == pgid && q->state != UNUSED && q->state != ZOMBIE)
+                break;
+        if(q == &ptable.proc[NPROC]){
+            popcli();
+            return -1;
+        }
+    }
+    p->pgid = pgid;
+    popcli();
+    return 0;
+}
+
+// Return the process group of process pid (0 for the caller).
+int getpgid(int pid)
+{
+    struct proc *p;
+    int pgid;
+
+    pushcli();
+    p = pid == 0 ? myproc() : findproc(pid);
+    pgid = p ? p->pgid : -1;
+    popcli();
+    return pgid;
+}
+
+// Set the nice value (-20..19) of process pid, or of the
+// caller if pid is 0. Lower values get a larger CPU share.
+int setpriority(int pid, int nice)
+{
+    struct proc *p;
+
+    if(nice < -20 || nice > 19)
+        return -1;
+    pushcli();
+    p = pid == 0 ? myproc() : findproc(pid);
+    if(p == 0){
+        popcli();
+        return -1;
+    }
+    p->nice = nice;
+    popcli();
+    return 0;
+}
+
+// Set the scheduling class of process pid (0 for the caller):
+// SCHED_OTHER, or SCHED_FIFO with a priority from 1 to RTPRIO_MAX.
+int setscheduler(int pid, int policy, int prio)
+{
+    struct proc *p;
+
+    if(policy == SCHED_OTHER)
+        prio = 0;
+    else if(policy != SCHED_FIFO || prio < 1 || prio > RTPRIO_MAX)
+        return -1;
+    pushcli();
+    p = pid == 0 ? myproc() : findproc(pid);
+    if(p == 0){
+        popcli();
+        return -1;
+    }
+    p->rtprio = prio;
+    popcli();
+    return 0;
+}
+
+// Restrict process pid (0 for the caller) to the CPUs in mask.
+// A caller now on a CPU outside its mask moves at once. A process
+// queued on such a CPU is requeued on an allowed one, since that
+// CPU would never run it and the others might never steal it; any
+// other process moves the next time it is scheduled.
+int setaffinity(int pid, uint mask)
+{
+    struct proc *p;
+    int move, i;
+
+    mask &= (1 << ncpu) - 1;
+    if(mask == 0)
+        return -1;
+    pushcli();
+    p = pid == 0 ? myproc() : findproc(pid);
+    if(p == 0){
+        popcli();
+        return -1;
+    }
+    p->affinity = mask;
+    if(p->state == RUNNABLE){
+        for(i = 0; i < ncpu; i++){
+            if(!(mask & (1 << i)) && runqremove(&runqs[i], p)){
+                setrunnable(p);
+                break;
+            }
+        }
+    }
+    // cpuid() needs interrupts off: decide before popcli().
+    move = p == myproc() && !(mask & (1 << cpuid()));
+    popcli();
+    if(move)
+        yield();
+    return 0;
+}
+
+// Return the affinity mask of process pid (0 for the caller),
+// limited to the CPUs present, or -1 if there is no such process.
+int getaffinity(int pid)
+{
+    struct proc *p;
+    int mask;
+
+    pushcli();
+    p = pid == 0 ? myproc() : findproc(pid);
+    mask = p ? p->affinity & ((1 << ncpu) - 1) : -1;
+    popcli();
+    return mask;
+}
+
+// Run signal handlers on the stack [sp, sp+size) instead of the
+// stack of the code they interrupt, or on that stack again if
+// size is 0. Returns -1 if the new stack is not in user memory or
+// is smaller than MINSIGSTKSZ, or if a handler is running on the
+// old one.
+int sigaltstack(uint sp, uint size){
+    struct proc *p = myproc();
+
+    if(p->altsize > 0 && p->tf->esp - p->altstack < p->altsize)
+        return -1;
+    if(size == 0){
+        p->altstack = p->altsize = 0;
+        return 0;
+    }
+    if(size < MINSIGSTKSZ || sp + size < sp || sp + size > p->sz)
+        return -1;
+    p->altstack = sp;
+    p->altsize = size;
+    return 0;
+}
+
+// Return from a signal handler through the frame user_handler()
+// pushed. The handler's ret has popped the trampoline address, so
+// esp points at its two arguments, with the saved mask and the
+// saved trap frame above them.
 void sigret(void)
 {
     struct proc *p = myproc();
+    struct trapframe tf;
+    uint sp, mask;
+
+    sp = p->tf->esp + 8;
+    if(sp < p->tf->esp || sp >= p->sz || p->sz - sp < 4 + sizeof(tf)){
+        p->killed = 1;
+        return;
+    }
+    mask = *(uint*)sp;
+    memmove(&tf, (void*)(sp + 4), sizeof(tf));
+    // The frame is in user memory: never let it return to the kernel,
+    // or with privileges (port I/O, vm86, task nesting) that iret
+    // would honour.
+    tf.cs = (SEG_UCODE << 3) | DPL_USER;
+    tf.ds = tf.es = tf.ss = (SEG_UDATA << 3) | DPL_USER;
+    tf.fs = tf.gs = 0;  // a bad selector would fault trapret's pops
+    tf.eflags = (tf.eflags & ~(FL_IOPL_MASK|FL_VM|FL_NT|FL_VIF|FL_VIP)) | FL_IF;
     pushcli();
-    memmove(p->tf,p->user_tf_backup,sizeof(*p->tf));
-    p->signal_mask = p->signal_mask_backup;
+    *p->tf = tf;
+    p->signal_mask = mask;
     popcli();
 }
 //=================END System calls================================================================
@@ -116,10 +876,7 @@ void default_handler(int signum){
     struct proc *p = myproc();
 
     if (signum == SIGSTOP){
-        while(!(isBitOn(p->pending_signals,SIGCONT))) {
-            yield();
-        }
-        return;
+        stopproc();
     }
     else if (signum == SIGCONT){
         if(isBitOn(p->pending_signals,SIGSTOP)){
@@ -135,7 +892,14 @@ void default_handler(int signum){
     else{
         pushcli();
         p->killed = 1;
-        cas(&p->state, SLEEPING, RUNNABLE);
+        wakesleeper(p);
+        // A fatal signal to a thread kills its whole process;
+        // the main thread's exit() takes down the others.
+        if(p->isthread){
+            p->parent->killed = 1;
+            wakesleeper(p->parent);
+            contproc(p->parent);
+        }
         popcli();
     }
     //p->signal_mask = p->signal_mask_backup;//????
@@ -147,47 +911,87 @@ void default_handler(int signum){
     popcli();
     return;
 }
-void user_handler(int signum){
+// Arrange for the user handler of signum to run on the next return
+// to user space. The frame pushed on the user stack holds, from the
+// top down: the trap frame to resume, the signal mask to restore,
+// and the handler's arguments and return address, which is the
+// trampoline page that calls sigret(). Frames nest: the one pushed
+// last runs first, and its sigret() resumes the handler whose frame
+// lies beneath it.
+// The handler is called as handler(signum, value); those installed
+// as plain sighandler_t just ignore the value.
+// With a sigaltstack(), the first frame goes at its top, and any
+// handler interrupting a handler nests below on the same stack.
+// Returns -1 if the frame does not fit on the user stack.
+int user_handler(int signum, int value){
   struct proc *p = myproc();
-  pushcli();
-  uint sp = p->tf->esp;
+  uint sp, lo, args[3];
+
+  sp = p->tf->esp;
+  lo = 0;
+  if(p->altsize > 0){
+    if(sp - p->altstack >= p->altsize)
+      sp = p->altstack + p->altsize;
+    lo = p->altstack;
+  }
+  if(sp > p->sz || sp < lo + sizeof(struct trapframe) + 4 + sizeof(args))
+    return -1;
   sp -= sizeof(struct trapframe);
-  p->user_tf_backup = (struct trapframe *)sp;
-  memmove(p->user_tf_backup, p->tf,sizeof(struct trapframe));
-  uint func_size = call_sigret_end - call_sigret;
-  sp -= func_size;
-  uint sigret_address = sp;
-  memmove((void*)sp, call_sigret, func_size);
-  sp -= 4;
-  *(int *)sp = signum;
+  if(copyout(p->pgdir, sp, p->tf, sizeof(struct trapframe)) < 0)
+    return -1;
   sp -= 4;
-  *(uint *)sp = sigret_address;
+  if(copyout(p->pgdir, sp, &p->signal_mask, 4) < 0)
+    return -1;
+  args[0] = TRAMPOLINE;
+  args[1] = signum;
+  args[2] = value;
+  sp -= sizeof(args);
+  if(copyout(p->pgdir, sp, args, sizeof(args)) < 0)
+    return -1;
   p->tf->esp = sp;
   p->tf->eip = (uint)p->signal_handlers[signum];
-  //p->signal_mask = p->signal_mask_backup;
-  uint cur_pending;
-  do{
-      cur_pending = p->pending_signals;
-  }while(!cas(&p->pending_signals, cur_pending, clearBit(cur_pending,signum)));
-  popcli();
-  return;
-
+  p->signal_mask = setBit(p->signal_mask, signum);
+  return 0;
 }
 //=================END HANDLERS====================================================================
 //-------------------------------------------------------------------------------------------------
 
+// Pids are handed out so that (pid-1) % NPROC is the slot of the
+// process that owns them. ptable.proc is then its own pid index:
+// findproc() is a single probe, and reusing a slot needs no
+// bookkeeping beyond allocproc() setting p->pid and wait() clearing it.
+#define PIDSLOT(pid) (((pid) - 1) % NPROC)
+
 int 
-allocpid(void) 
+allocpid(struct proc *p) 
 {
-    int pid;
+    int base, pid, slot;
 
+    slot = p - ptable.proc;
     do{
-        pid = nextpid;
-    } while(!cas(&nextpid, pid, pid+1));
+        base = nextpid;
+        pid = base + (slot - PIDSLOT(base) + NPROC) % NPROC;
+    } while(!cas(&nextpid, base, pid+1));
 
     return pid;
 }
 
+// Return the process with the given pid, or 0 if there is none.
+// The slot may be recycled as soon as this returns; callers only
+// use the result for CAS updates that tolerate that.
+static struct proc*
+findproc(int pid)
+{
+  struct proc *p;
+
+  if(pid <= 0)
+    return 0;
+  p = &ptable.proc[PIDSLOT(pid)];
+  if(p->pid != pid)
+    return 0;
+  return p;
+}
+
 
 //PAGEBREAK: 32
 // Look in the process table for an UNUSED proc.
@@ -199,6 +1003,7 @@ allocproc(void)
 {
   struct proc *p;
   char *sp;
+  int i;
 
   pushcli();
   do {
@@ -212,7 +1017,30 @@ allocproc(void)
       }
   } while (!cas(&p->state, UNUSED, EMBRYO));
   popcli();
-  p->pid = allocpid();
+  p->pid = allocpid(p);
+  p->pgid = 0;
+  p->children = 0;
+  p->sibling = 0;
+  p->isthread = 0;
+  p->nthreads = 0;
+  p->ustack = 0;
+  p->nice = 0;
+  p->rtprio = 0;
+  p->vruntime = 0;
+  p->affinity = ~0;
+  p->lastcpu = -1;
+  p->cputicks = 0;
+  p->waitticks = 0;
+  p->nswitch = 0;
+  p->nmigrate = 0;
+  for(i = 0; i < NSIGQ; i++)
+    p->sigq[i].seq = i;
+  p->sigqhead = 0;
+  p->sigqtail = 0;
+  p->nsignals = 0;
+  p->alarmset = 0;
+  p->altstack = 0;
+  p->altsize = 0;
 
 
   // Allocate kernel stack.
@@ -250,6 +1078,7 @@ userinit(void)
   p = allocproc();
   
   initproc = p;
+  p->pgid = p->pid;
   if((p->pgdir = setupkvm()) == 0)
     panic("userinit: out of memory?");
   inituvm(p->pgdir, _binary_initcode_start, (int)_binary_initcode_size);
@@ -268,7 +1097,6 @@ userinit(void)
   //---------------2.1.2 INIT OF PROCESS MASK,PENDING SIGNALS,HANDLERS,FRAME BACKUP----------------
   p->signal_mask = 0;
   p->pending_signals = 0;
-  p->user_tf_backup = 0;
   int i;
   for (i = 0; i < 32; i++){
     p->signal_handlers[i] =(void *) SIG_DFL;
@@ -281,28 +1109,41 @@ userinit(void)
   // because the assignment might not be atomic.
 
   p->state = RUNNABLE;
-
+  setrunnable(p);
 }
 
-// Grow current process's memory by n bytes.
-// Return 0 on success, -1 on failure.
+// Grow current process's memory by n bytes, along with that
+// of every thread sharing it.
+// Return the old size on success, -1 on failure.
+// Shrinking does not flush the TLBs of other CPUs that are
+// running those threads; a thread that keeps using memory
+// another thread has freed gets what it deserves.
 int
 growproc(int n)
 {
-  uint sz;
+  uint sz, oldsz;
+  struct proc *p;
   struct proc *curproc = myproc();
 
-  sz = curproc->sz;
+  acquire(&growlock);
+  oldsz = sz = curproc->sz;
   if(n > 0){
-    if((sz = allocuvm(curproc->pgdir, sz, sz + n)) == 0)
+    if((sz = allocuvm(curproc->pgdir, sz, sz + n)) == 0){
+      release(&growlock);
       return -1;
+    }
   } else if(n < 0){
-    if((sz = deallocuvm(curproc->pgdir, sz, sz + n)) == 0)
+    if((sz = deallocuvm(curproc->pgdir, sz, sz + n)) == 0){
+      release(&growlock);
       return -1;
+    }
   }
-  curproc->sz = sz;
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    if(p->state != UNUSED && p->pgdir == curproc->pgdir)
+      p->sz = sz;
+  release(&growlock);
   switchuvm(curproc);
-  return 0;
+  return oldsz;
 }
 
 // Create a new process copying p as the parent.
@@ -329,6 +1170,11 @@ fork(void)
   }
   np->sz = curproc->sz;
   np->parent = curproc;
+  np->pgid = curproc->pgid;
+  np->nice = curproc->nice;
+  np->rtprio = curproc->rtprio;
+  np->vruntime = curproc->vruntime;
+  np->affinity = curproc->affinity;
   *np->tf = *curproc->tf;
   //---------------2.1.2 UPDATE FOR CHILD PROCESS--------------------------------------------------
     np->pending_signals = 0;
@@ -336,6 +1182,8 @@ fork(void)
     for (i = 0; i < 32; i++){
         np->signal_handlers[i] = curproc->signal_handlers[i];
     }
+    np->altstack = curproc->altstack;
+    np->altsize = curproc->altsize;
   //---------------END UPDATE OF CHILD PROCESS-----------------------------------------------------
   // Clear %eax so that fork returns 0 in the child.
   np->tf->eax = 0;
@@ -348,9 +1196,88 @@ fork(void)
   safestrcpy(np->name, curproc->name, sizeof(curproc->name));
 
   pid = np->pid;
+  addchildren(curproc, np, np);
 
+  pushcli();
   if (!cas(&np->state, EMBRYO, RUNNABLE))
      panic("fork: cas failed");
+  setrunnable(np);
+  popcli();
+  return pid;
+}
+
+// Create a thread: a process sharing the caller's address space
+// and signal handlers, which starts by calling fcn(arg1, arg2) on
+// the one-page user stack at stack. Every thread belongs to the
+// main thread of its process, which must join() it. Open files are
+// duplicated as by fork(), so threads share file offsets but not
+// later opens and closes.
+int
+clone(void (*fcn)(void*, void*), void *arg1, void *arg2, void *stack)
+{
+  int i, pid, n;
+  uint sp, ustack[3];
+  struct proc *np, *leader;
+  struct proc *curproc = myproc();
+
+  if((uint)stack % PGSIZE != 0 || (uint)stack + PGSIZE > curproc->sz)
+    return -1;
+  if((np = allocproc()) == 0)
+    return -1;
+  leader = curproc->isthread ? curproc->parent : curproc;
+
+  // Fake return PC, then the arguments.
+  ustack[0] = 0xffffffff;
+  ustack[1] = (uint)arg1;
+  ustack[2] = (uint)arg2;
+  sp = (uint)stack + PGSIZE - sizeof(ustack);
+  if(copyout(curproc->pgdir, sp, ustack, sizeof(ustack)) < 0){
+    kfree(np->kstack);
+    np->kstack = 0;
+    np->state = UNUSED;
+    return -1;
+  }
+
+  // Join the address space under growlock, so a concurrent
+  // growproc() either sees us or has already set sz.
+  acquire(&growlock);
+  np->pgdir = curproc->pgdir;
+  np->sz = curproc->sz;
+  release(&growlock);
+  np->isthread = 1;
+  np->ustack = stack;
+  np->parent = leader;
+  np->pgid = curproc->pgid;
+  np->nice = curproc->nice;
+  np->rtprio = curproc->rtprio;
+  np->vruntime = curproc->vruntime;
+  np->affinity = curproc->affinity;
+  *np->tf = *curproc->tf;
+  np->tf->esp = sp;
+  np->tf->eip = (uint)fcn;
+  np->pending_signals = 0;
+  np->signal_mask = curproc->signal_mask;
+  for(i = 0; i < 32; i++)
+    np->signal_handlers[i] = curproc->signal_handlers[i];
+
+  for(i = 0; i < NOFILE; i++)
+    if(curproc->ofile[i])
+      np->ofile[i] = filedup(curproc->ofile[i]);
+  np->cwd = idup(curproc->cwd);
+
+  safestrcpy(np->name, curproc->name, sizeof(curproc->name));
+
+  pid = np->pid;
+  do{
+    n = leader->nthreads;
+  } while(!cas(&leader->nthreads, n, n+1));
+  addchildren(leader, np, np);
+
+  pushcli();
+  if(!cas(&np->state, EMBRYO, RUNNABLE))
+    panic("clone: cas failed");
+  setrunnable(np);
+  popcli();
   return pid;
 }
 
@@ -361,12 +1288,30 @@ void
 exit(void)
 {
   struct proc *curproc = myproc();
-  struct proc *p;
+  struct proc *p, *first;
   int fd;
 
   if(curproc == initproc)
     panic("init exiting");
 
+  // Our threads run in our address space, which wait() is about
+  // to free: kill them and collect them first.
+  while(curproc->nthreads > 0){
+    pushcli();
+    for(p = curproc->children; p; p = p->sibling){
+      if(p->isthread){
+        p->killed = 1;
+        wakesleeper(p);
+        contproc(p);
+      }
+    }
+    popcli();
+    reap(1, 0, 0);
+  }
+
+  // Take our interval timer off the wheel.
+  setitimer(0, 0);
+
   // Close all open files.
   for(fd = 0; fd < NOFILE; fd++){
     if(curproc->ofile[fd]){
@@ -385,13 +1330,19 @@ exit(void)
       panic("cas failed in exit");
   }
 
-  // Pass abandoned children to init.
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->parent == curproc){
+  // Pass abandoned children to init. Nobody else adds to our
+  // list, so it can be handed over whole. A child that turns
+  // ZOMBIE meanwhile wakes whichever parent it sees, so wake
+  // init afterwards in case it saw us.
+  if((first = curproc->children) != 0){
+    curproc->children = 0;
+    for(p = first;; p = p->sibling){
       p->parent = initproc;
-      if(p->state == ZOMBIE)
-        wakeup1(initproc);
+      if(p->sibling == 0)
+        break;
     }
+    addchildren(initproc, first, p);
+    wakeup1(initproc, 0);
   }
   sched();
   panic("zombie exit");
@@ -401,35 +1352,58 @@ exit(void)
 // Return -1 if this process has no children.
 int
 wait(void)
+{
+  return reap(0, 0, 1);
+}
+
+// Wait for one of this process's threads to exit and return its
+// pid, storing the stack it was given by clone() in *stack.
+// Return -1 if this process has no threads.
+int
+join(void **stack)
+{
+  return reap(1, stack, 1);
+}
+
+// Free a zombie child: a process for wait(), or a thread for join(),
+// whose address space lives on with the rest of its process.
+// Gives up if the caller is killed or signalled, unless killable is 0.
+static int
+reap(int threads, void **stack, int killable)
 {
   struct proc *p;
-  int havekids, pid;
+  int havekids, pid, n;
   struct proc *curproc = myproc();
   pushcli();
   for(;;){
-    if(!cas(&curproc->state, RUNNING, NEG_SLEEPING)){
-        panic("first cas failed in wait");
-    }
-    curproc->chan = curproc;
-    // Scan through table looking for exited children.
+    // Go on the wait queue before scanning, so that a child
+    // turning ZOMBIE after the scan still finds us to wake.
+    sleepon(curproc, curproc, killable ? WQINTR : 0);
+    // Scan through our children looking for exited ones.
     havekids = 0;
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->parent != curproc)
+    for(p = curproc->children; p; p = p->sibling){
+      if(p->isthread != threads)
         continue;
       havekids = 1;
       if(cas(&p->state, ZOMBIE, NEG_UNUSED)){
         // Found one.
+        cancelsleep(curproc, curproc);
+        removechild(curproc, p);
         pid = p->pid;
         kfree(p->kstack);
         p->kstack = 0;
-        freevm(p->pgdir);
+        if(threads){
+          if(stack)
+            *stack = p->ustack;
+          do{
+            n = curproc->nthreads;
+          } while(!cas(&curproc->nthreads, n, n-1));
+        } else
+          freevm(p->pgdir);
         p->pid = 0;
         p->parent = 0;
         p->name[0] = 0;
         p->killed = 0;
-        curproc->chan = 0;
-        cas(&curproc->state, NEG_SLEEPING, RUNNING);
-          // release(&ptable.lock);
         if(!cas(&p->state, NEG_UNUSED, UNUSED)){
             panic("CAS FAILED LINE 434 IN PROC.C");
         }
@@ -439,11 +1413,8 @@ wait(void)
     }
 
     // No point waiting if we don't have any children.
-    if(!havekids || curproc->killed){
-      curproc->chan = 0;
-      if(!cas(&curproc->state, NEG_SLEEPING, RUNNING)){
-          panic("fourth cas faild in wait");
-      }
+    if(!havekids || (killable && interrupted(curproc))){
+      cancelsleep(curproc, curproc);
       popcli();
       return -1;
     }
@@ -472,16 +1443,23 @@ scheduler(void)
     // Enable interrupts on this processor.
     sti();
 
-    // Loop over process table looking for process to run.
+    // Take the next process off this CPU's run queue,
+    // or steal one from a sibling.
     pushcli();
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if((p = pickproc()) != 0){
       if(!cas(&p->state, RUNNABLE, RUNNING))
-          continue;
+        panic("scheduler: queued proc not runnable");
 
       // Switch to chosen process.  It is the process's job
       // to release ptable.lock and then reacquire it
       // before jumping back to us.
       c->proc = p;
+      c->resched = 0;
+      p->nswitch++;
+      if(p->lastcpu >= 0 && p->lastcpu != c - cpus)
+        p->nmigrate++;
+      p->lastcpu = c - cpus;
+      p->waitticks += ticks - p->readytick;
       switchuvm(p);
 
       swtch(&(c->scheduler), p->context);
@@ -490,19 +1468,28 @@ scheduler(void)
       // Process is done running for now.
       // It should have changed its p->state before coming back.
       c->proc = 0;
+      // A process killed as it went to sleep would miss kill()'s
+      // wakeup: wake it now. Leave killed set, so that it dies.
       if (cas(&p->state, NEG_SLEEPING, SLEEPING)) {
-          if (cas(&p->killed, 1, 0))
-              p->state = RUNNABLE;
+          if (p->killed)
+              wakesleeper(p);
       }
       if(cas(&p->state, NEG_ZOMBIE, ZOMBIE)){
-        wakeup1(p->parent);
+        wakeup1(p->parent, 0);
       }
+      // Before the NEG_RUNNABLE check: a contproc() racing with us
+      // turns NEG_STOPPED into NEG_RUNNABLE, which is then caught
+      // below, or finds STOPPED and requeues p itself.
+      cas(&p->state, NEG_STOPPED, STOPPED);
       if (cas(&p->state, NEG_RUNNABLE, RUNNABLE)) {
-
+        setrunnable(p);
       }
     }
     popcli();
 
+    // Nothing to run anywhere: halt instead of spinning.
+    if(p == 0)
+      cpuidle(c);
   }
 }
 
@@ -566,8 +1553,10 @@ forkret(void)
 
 // Atomically release lock and sleep on chan.
 // Reacquires lock when awakened.
-void
-sleep(void *chan, struct spinlock *lk)
+// Returns -1 if WQINTR is set and the sleep was cut short by a
+// signal (or never started because one was already pending).
+static int
+sleep1(void *chan, struct spinlock *lk, int flags)
 {
   struct proc *p = myproc();
 
@@ -577,48 +1566,79 @@ sleep(void *chan, struct spinlock *lk)
   if(lk == 0)
     panic("sleep without lk");
 
-  // Must acquire ptable.lock in order to
-  // change p->state and then call sched.
-  // Once we hold ptable.lock, we can be
-  // guaranteed that we won't miss any wakeup
-  // (wakeup runs with ptable.lock locked),
-  // so it's okay to release lk.
+  // Once p is on chan's wait queue in NEG_SLEEPING, any
+  // wakeup (which runs with lk held) will find it, so it's
+  // okay to release lk before calling sched.
   pushcli();
 
   // Go to sleep.
-  p->chan = chan;
-  if(!cas(&p->state, RUNNING, NEG_SLEEPING)){
-      panic("cas failed in sleep");
+  sleepon(p, chan, flags);
+  if((flags & WQINTR) && interrupted(p)){
+    cancelsleep(p, chan);
+    popcli();
+    return -1;
   }
   release(lk);
   sched();
   acquire(lk);
 
   popcli();
+  if((flags & WQINTR) && interrupted(p))
+    return -1;
+  return 0;
+}
+
+// Sleep on chan; every wakeup(chan) wakes us.
+void
+sleep(void *chan, struct spinlock *lk)
+{
+  sleep1(chan, lk, 0);
+}
 
+// Like sleep(), or sleepexcl() if excl, but a signal the process
+// would act on also wakes it. Returns -1 if a signal is pending
+// (or the process is killed), so the caller can give up at once
+// instead of waiting for the next wakeup.
+int
+sleepintr(void *chan, struct spinlock *lk, int excl)
+{
+  return sleep1(chan, lk, WQINTR | (excl ? WQEXCL : 0));
+}
 
+// Sleep on chan as an exclusive waiter: wakeupone(chan) wakes
+// only the oldest exclusive waiter, so callers that can't all
+// make progress don't stampede. wakeup(chan) still wakes us.
+void
+sleepexcl(void *chan, struct spinlock *lk)
+{
+  sleep1(chan, lk, WQEXCL);
 }
 
 //PAGEBREAK!
-// Wake up all processes sleeping on chan.
-// The ptable lock must be held.
+// Wake up the processes sleeping on chan: every non-exclusive
+// waiter, and either all exclusive waiters or just the first.
+// Must be called with interrupts disabled.
 static void
-wakeup1(void *chan)
+wakeup1(void *chan, int one)
 {
-  struct proc *p;
-
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
-      if (p->chan == chan && (p->state == SLEEPING || p->state == NEG_SLEEPING)) {
-         while (p->state == NEG_SLEEPING) {
-                // busy-wait
-          }
-          if (cas(&p->state, SLEEPING, NEG_RUNNABLE)) {
-             p->chan = 0;
-             if (!cas(&p->state, NEG_RUNNABLE, RUNNABLE))
-                 panic("wakeup1: cas failed");
-          }
-      }
+  struct waitq *wq = WAITQ(chan);
+  struct proc *p, **pp;
+  int excl;
+
+  acquire(&wq->lock);
+  for(pp = &wq->head; (p = *pp) != 0; ){
+    if(p->chan != chan){
+      pp = &p->wqnext;
+      continue;
+    }
+    *pp = p->wqnext;
+    p->wqnext = 0;
+    excl = p->wqexcl;
+    wakeproc(p);
+    if(one && excl)
+      break;
   }
+  release(&wq->lock);
 }
 
 // Wake up all processes sleeping on chan.
@@ -626,65 +1646,361 @@ void
 wakeup(void *chan)
 {
   pushcli();
-  wakeup1(chan);
+  wakeup1(chan, 0);
+  popcli();
+}
+
+// Wake up the non-exclusive sleepers on chan and at most
+// one exclusive sleeper (see sleepexcl).
+void
+wakeupone(void *chan)
+{
+  pushcli();
+  wakeup1(chan, 1);
   popcli();
 }
 
-// Kill the process with the given pid.
-// Process won't exit until it returns
+//PAGEBREAK!
+// Futexes. A process waiting on a user word sleeps on the kernel
+// address of that word, so every thread sharing the page agrees
+// on the channel. The caller has checked that addr is in range.
+static void*
+futexchan(uint addr)
+{
+  char *ka;
+
+  if(addr % 4 != 0)
+    return 0;
+  if((ka = uva2ka(myproc()->pgdir, (char*)addr)) == 0)
+    return 0;
+  return ka + (addr & (PGSIZE-1));
+}
+
+// Sleep until futexwake() on addr, provided *addr still holds val.
+// Returns 0 when woken, -1 if *addr had already changed or a
+// signal is pending.
+int
+futexwait(uint addr, uint val)
+{
+  struct proc *p = myproc();
+  volatile uint *word;
+
+  if((word = futexchan(addr)) == 0)
+    return -1;
+  pushcli();
+  // Check *addr only once on the wait queue: whoever changes it
+  // and then calls futexwake() is sure to find us there.
+  sleepon(p, (void*)word, WQEXCL|WQINTR);
+  if(*word != val || interrupted(p)){
+    cancelsleep(p, (void*)word);
+    popcli();
+    return -1;
+  }
+  sched();
+  popcli();
+  return 0;
+}
+
+// Wake at most n processes waiting on addr.
+// Returns the number woken, or -1 if addr is bad.
+int
+futexwake(uint addr, int n)
+{
+  struct waitq *wq;
+  struct proc *p, **pp;
+  void *chan;
+  int woken;
+
+  if((chan = futexchan(addr)) == 0)
+    return -1;
+  wq = WAITQ(chan);
+  woken = 0;
+  pushcli();
+  acquire(&wq->lock);
+  for(pp = &wq->head; woken < n && (p = *pp) != 0; ){
+    if(p->chan != chan){
+      pp = &p->wqnext;
+      continue;
+    }
+    *pp = p->wqnext;
+    p->wqnext = 0;
+    wakeproc(p);
+    woken++;
+  }
+  release(&wq->lock);
+  popcli();
+  return woken;
+}
+
+// Send signal signum to the process with the given pid.
+// Process won't act on it until it returns
 // to user space (see trap in trap.c).
+// A pid of 0 means every process in the caller's group, and
+// -pgid every process in group pgid, all posted in one pass.
 int
 kill(int pid, int signum)
 {
   struct proc *p;
-  pushcli();
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->pid == pid){
-      if(p->state == ZOMBIE){
-          popcli();
-          return -1;
-      }
+  int pgid, r;
 
-      p->pending_signals = setBit(p->pending_signals,signum);
-      popcli();
-      return 0;
+  if(signum < 0 || signum > SIGRTMAX)
+    return -1;
+  pushcli();
+  if(pid <= 0){
+    pgid = pid == 0 ? myproc()->pgid : -pid;
+    r = -1;
+    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+      if(p->pgid == pgid && p->state != UNUSED && p->state != EMBRYO &&
+         p->state != ZOMBIE && p->state != NEG_ZOMBIE && sendsig(p, signum) == 0)
+        r = 0;
     }
+    popcli();
+    return r;
+  }
+  if((p = findproc(pid)) == 0 || p->state == ZOMBIE){
+    popcli();
+    return -1;
+  }
+  r = sendsig(p, signum);
+  popcli();
+  return r;
+}
+
+// Post signum to p, and cut short an interruptible sleep if p
+// will act on it. SIGCONT and SIG_KILL also restart p if it is
+// stopped.
+int
+sendsig(struct proc *p, int signum)
+{
+  uint cur_pending;
+
+  // Real-time signals are queued, not coalesced.
+  if(signum >= SIGRTMIN){
+    if(sigqput(p, signum, 0) < 0)
+      return -1;
+  } else {
+    do{
+        cur_pending = p->pending_signals;
+    }while(!cas(&p->pending_signals, cur_pending, setBit(cur_pending,signum)));
+  }
+  if(signum == SIGCONT || signum == SIG_KILL)
+    contproc(p);
+  if(wantsig(p, signum))
+    wakeintr(p);
+  return 0;
+}
+
+// Queue real-time signal signum, carrying value, for process pid.
+// Unlike kill(), every signal sent is delivered, in the order sent.
+// Returns -1 if pid is not alive or its queue is full.
+int
+sigqueue(int pid, int signum, int value)
+{
+  struct proc *p;
+  int r;
+
+  if(signum < SIGRTMIN || signum > SIGRTMAX)
+    return -1;
+  pushcli();
+  if((p = findproc(pid)) == 0 || p->state == ZOMBIE){
+    popcli();
+    return -1;
   }
+  if((r = sigqput(p, signum, value)) == 0 && wantsig(p, signum))
+    wakeintr(p);
   popcli();
+  return r;
+}
+
+// Add a signal to p's queue. Any number of senders may race here:
+// each claims a position by advancing sigqtail with CAS, and
+// publishes the slot by bumping its seq (see struct sigqent).
+static int
+sigqput(struct proc *p, int signum, int value)
+{
+  struct sigqent *e;
+  uint pos;
+  int diff;
+
+  pos = p->sigqtail;
+  for(;;){
+    e = &p->sigq[pos % NSIGQ];
+    diff = (int)(e->seq - pos);
+    if(diff == 0){
+      if(cas(&p->sigqtail, pos, pos + 1))
+        break;
+    } else if(diff < 0)
+      return -1;
+    pos = p->sigqtail;
+  }
+  e->signum = signum;
+  e->value = value;
+  e->seq = pos + 1;
+  return 0;
+}
+
+// Take the signal at the head of p's queue, provided it is in
+// mask. Only p itself takes from its queue, so no CAS is needed.
+static int
+sigqpop(struct proc *p, uint mask, int *signum, int *value)
+{
+  struct sigqent *e;
+  uint pos;
+
+  pos = p->sigqhead;
+  e = &p->sigq[pos % NSIGQ];
+  if(e->seq != pos + 1 || !isBitOn(mask, e->signum))
+    return 0;
+  *signum = e->signum;
+  *value = e->value;
+  e->seq = pos + NSIGQ;
+  p->sigqhead = pos + 1;
+  return 1;
+}
+
+// Take the signal at the head of the current process's queue,
+// unless the queue is empty or that signal is masked.
+int
+sigqget(int *signum, int *value)
+{
+  struct proc *p = myproc();
+
+  return sigqpop(p, ~p->signal_mask, signum, value);
+}
+
+// Consume a pending signal in mask without running its handler,
+// lowest numbered first and then the head of the queue. Returns
+// its number, with its payload (0 if none) in *value, or -1.
+static int
+sigtake(struct proc *p, uint mask, int *value)
+{
+  uint cur;
+  int signum;
+
+  for(;;){
+    cur = p->pending_signals;
+    if((cur & mask) == 0)
+      break;
+    signum = bsf(cur & mask);
+    if(cas(&p->pending_signals, cur, clearBit(cur, signum))){
+      *value = 0;
+      return signum;
+    }
+  }
+  if(sigqpop(p, mask, &signum, value))
+    return signum;
   return -1;
 }
 
+// Wait for a signal in mask and consume it, as sigtake() does.
+// Waits at most ticks clock ticks, or forever if ticks < 0.
+// Returns -1 on timeout, or if another signal or kill() ends the
+// wait first; that signal's handler then runs as usual. SIG_KILL
+// and SIGSTOP cannot be waited for.
+int
+sigtimedwait(uint mask, int *value, int ticks)
+{
+  struct proc *p = myproc();
+  int signum;
+
+  mask &= ~((1 << SIG_KILL) | (1 << SIGSTOP));
+  if((signum = sigtake(p, mask, value)) >= 0 || ticks == 0)
+    return signum;
+
+  // With sigwaitmask set, senders of a signal in mask wake us
+  // even if it is masked, and our interruptible sleep ends at
+  // once if one is already pending.
+  p->sigwaitmask = mask;
+  if(ticks > 0)
+    sleepticks(ticks);
+  else {
+    pushcli();
+    sleepon(p, &p->sigwaitmask, WQINTR);
+    if(interrupted(p))
+      cancelsleep(p, &p->sigwaitmask);
+    else
+      sched();
+    popcli();
+  }
+  p->sigwaitmask = 0;
+  return sigtake(p, mask, value);
+}
+
 //PAGEBREAK: 36
+static char *states[] = {
+[UNUSED]    "unused",
+[EMBRYO]    "embryo",
+[SLEEPING]  "sleep ",
+[RUNNABLE]  "runble",
+[RUNNING]   "run   ",
+[ZOMBIE]    "zombie",
+[NEG_UNUSED] "neg_unused",
+[NEG_SLEEPING] "neg_sleep ",
+[NEG_RUNNABLE] "neg_runnable",
+[NEG_ZOMBIE] "neg_zombie",
+[STOPPED]   "stopped",
+[NEG_STOPPED] "neg_stop  "
+};
+
+static char*
+statename(enum procstate s)
+{
+  if(s >= 0 && s < NELEM(states) && states[s])
+    return states[s];
+  return "???";
+}
+
+// Copy a snapshot of up to n live processes into info.
+// Returns the number of entries filled in.
+int
+getprocinfo(struct procinfo *info, int n)
+{
+  struct proc *p;
+  int i;
+
+  i = 0;
+  for(p = ptable.proc; p < &ptable.proc[NPROC] && i < n; p++){
+    if(p->state == UNUSED || p->state == NEG_UNUSED || p->state == EMBRYO)
+      continue;
+    info[i].pid = p->pid;
+    info[i].ppid = p->parent ? p->parent->pid : 0;
+    info[i].pgid = p->pgid;
+    safestrcpy(info[i].state, statename(p->state), sizeof(info[i].state));
+    safestrcpy(info[i].name, p->name, sizeof(info[i].name));
+    info[i].sz = p->sz;
+    info[i].nice = p->nice;
+    info[i].rtprio = p->rtprio;
+    info[i].cputicks = p->cputicks;
+    info[i].waitticks = p->waitticks;
+    info[i].nswitch = p->nswitch;
+    info[i].nmigrate = p->nmigrate;
+    info[i].cpu = p->lastcpu;
+    info[i].affinity = p->affinity;
+    info[i].nsignals = p->nsignals;
+    i++;
+  }
+  return i;
+}
+
 // Print a process listing to console.  For debugging.
 // Runs when user types ^P on console.
 // No lock to avoid wedging a stuck machine further.
 void
 procdump(void)
 {
-  static char *states[] = {
-  [UNUSED]    "unused",
-  [EMBRYO]    "embryo",
-  [SLEEPING]  "sleep ",
-  [RUNNABLE]  "runble",
-  [RUNNING]   "run   ",
-  [ZOMBIE]    "zombie",
-  [NEG_UNUSED] "neg_unused",
-  [NEG_SLEEPING] "neg_sleep ",
-  [NEG_RUNNABLE] "neg_runnable",
-  [NEG_ZOMBIE] "neg_zombie"
-  };
   int i;
   struct proc *p;
+  struct cpu *c;
   char *state;
   uint pc[10];
 
+  for(c = cpus; c < cpus+ncpu; c++)
+    cprintf("cpu%d: idle %d%% of %d ticks\n", c - cpus,
+            c->nticks ? c->idleticks * 100 / c->nticks : 0, c->nticks);
   for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
     if(p->state == UNUSED || p->state == NEG_UNUSED)
       continue;
-    if(p->state >= 0 && p->state < NELEM(states) && states[p->state])
-      state = states[p->state];
-    else
-      state = "???";
+    state = statename(p->state);
     cprintf("%d %s %s", p->pid, state, p->name);
     if(p->state == SLEEPING){
       getcallerpcs((uint*)p->context->ebp+2, pc);
@@ -8,6 +8,11 @@ struct cpu {
   int ncli;                    // Depth of pushcli nesting.
   int intena;                  // Were interrupts enabled before pushcli?
   struct proc *proc;           // The process running on this cpu or null
+  int resched;                 // A real-time process is waiting to preempt proc
+  volatile int idle;           // Halted in scheduler(); clear it and send T_RESCHED to wake
+  volatile int oneshot;        // CPU 0 only: halted with its clock tick off
+  uint nticks;                 // Timer interrupts taken by this cpu
+  uint idleticks;              // ... of which arrived with no process running
 };
 
 extern struct cpu cpus[NCPU];
@@ -32,29 +37,78 @@ struct context {
   uint eip;
 };
 
-enum procstate { UNUSED, EMBRYO, SLEEPING, RUNNABLE, RUNNING, ZOMBIE,NEG_UNUSED,NEG_SLEEPING,NEG_RUNNABLE,NEG_ZOMBIE };
+// A queued real-time signal. seq says whose turn the slot is:
+// free for the sender claiming position pos when seq == pos, and
+// ready for delivery at position pos when seq == pos+1.
+struct sigqent {
+  volatile uint seq;
+  int signum;
+  int value;
+};
+
+enum procstate { UNUSED, EMBRYO, SLEEPING, RUNNABLE, RUNNING, ZOMBIE,NEG_UNUSED,NEG_SLEEPING,NEG_RUNNABLE,NEG_ZOMBIE,
+                 STOPPED, NEG_STOPPED };
 
-// Per-process state
+// Per-process state.
+// The fields other CPUs write on hot paths (the scheduler, wakeup,
+// kill) come first, on a cache line of their own: writes to them
+// must not evict the read-mostly fields the process itself uses on
+// every system call, nor a neighbouring slot's fields.
 struct proc {
-    uint sz;                     // Size of process memory (bytes)
+    // Hot: written or polled by other CPUs.
+    enum procstate state;        // Process state
+    int killed;                  // If non-zero, have been killed
+    uint pending_signals;        //pending signals for the current process
+    uint signal_mask;            //all the masked signals of the current process
+    uint sigwaitmask;            // Signals sigtimedwait() is waiting for
+    volatile uint sigqtail;      // Next sigq position to fill
+    void *chan;                  // If non-zero, sleeping on chan
+    struct proc *wqnext;         // Next process on the same wait queue
+    int wqexcl;                  // Sleeping as an exclusive waiter
+    int wqintr;                  // Sleeping interruptibly: signals wake it
+    struct proc *rqnext;         // Next process on the same run queue
+    int lastcpu;                 // CPU it last ran on, or -1
+    uint readytick;              // When last queued by setrunnable()
+
+    // Cold: read-mostly, or private to the process.
+    uint sz __attribute__((aligned(CACHELINE)));  // Size of process memory (bytes)
     pde_t* pgdir;                // Page table
     char *kstack;                // Bottom of kernel stack for this process
-    enum procstate state;        // Process state
     int pid;                     // Process ID
+    int pgid;                    // Process group ID (see setpgid)
     struct proc *parent;         // Parent process
+    int isthread;                // Shares its parent's pgdir (see clone)
+    int nthreads;                // Threads cloned and not yet joined
+    void *ustack;                // User stack passed to clone()
+    struct proc *children;       // First child (see addchildren)
+    struct proc *sibling;        // Next child of the same parent
     struct trapframe *tf;        // Trap frame for current syscall
     struct context *context;     // swtch() here to run process
-    void *chan;                  // If non-zero, sleeping on chan
-    int killed;                  // If non-zero, have been killed
+    uint altstack;               // Bottom of the signal stack, see sigaltstack
+    uint altsize;                // Its size, or 0 to use the current stack
+    int alarmset;                // Interval timer armed
+    uint alarmtick;              // Tick at which it next posts SIGALRM
+    int alarmsub;                // ... and how far into it, in ITIMERRES units
+    uint alarminterval;          // ITIMERRES units between later SIGALRMs, or 0
+    struct proc *alarmnext;      // Next armed timer in its wheel slot
+    int nice;                    // Scheduling nice value, -20..19
+    int rtprio;                  // SCHED_FIFO priority, or 0 for SCHED_OTHER
+    uint vruntime;               // CPU ticks used, scaled by nice weight
+    uint affinity;               // Mask of CPUs this process may run on
     struct file *ofile[NOFILE];  // Open files
     struct inode *cwd;           // Current directory
     char name[16];               // Process name (debugging)
-    uint pending_signals;        //pending signals for the current process
-    uint signal_mask;            //all the masked signals of the current process
-    uint signal_mask_backup;     //For backing up signal mask
     void * signal_handlers[32];  //All the handlers of the current process
-    struct trapframe *user_tf_backup;  //users trap frame backup
-};
+    volatile uint sigqhead;      // Next sigq position to deliver
+    uint cputicks;               // Timer ticks spent running
+    uint waitticks;              // Ticks spent RUNNABLE on a run queue
+    uint nswitch;                // Times dispatched by scheduler()
+    uint nmigrate;               // ... of which on a different CPU than before
+    uint nsignals;               // Signals delivered by handleSignals()
+
+    // Written by senders, slot by slot.
+    struct sigqent sigq[NSIGQ] __attribute__((aligned(CACHELINE)));  // Queued real-time signals
+} __attribute__((aligned(CACHELINE)));
 
 // Process memory is laid out contiguously, low addresses first:
 //   text
@@ -0,0 +1,18 @@
+// Per-process accounting, as returned by getprocinfo().
+struct procinfo {
+  int pid;
+  int ppid;
+  int pgid;        // Process group
+  char state[16];  // Process state, as printed by procdump
+  char name[16];   // Process name
+  uint sz;         // Size of process memory (bytes)
+  int nice;        // Nice value
+  int rtprio;      // SCHED_FIFO priority, or 0
+  uint cputicks;   // Timer ticks spent running
+  uint waitticks;  // Ticks spent runnable but waiting for a CPU
+  uint nswitch;    // Times dispatched by scheduler()
+  uint nmigrate;   // ... of which on a different CPU than before
+  int cpu;         // CPU it last ran on, or -1
+  uint affinity;   // Mask of CPUs it may run on
+  uint nsignals;   // Signals delivered
+};
@@ -0,0 +1,27 @@
+// List processes with their CPU accounting.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "procinfo.h"
+
+struct procinfo info[NPROC];
+
+int
+main(int argc, char *argv[])
+{
+  int i, n;
+
+  if((n = getprocinfo(info, NPROC)) < 0){
+    printf(2, "ps: getprocinfo failed\n");
+    exit();
+  }
+  printf(1, "PID\tPPID\tPGID\tSTATE\tNICE\tRT\tCPU\tWAIT\tSWTCH\tSIGS\tSIZE\tNAME\n");
+  for(i = 0; i < n; i++)
+    printf(1, "%d\t%d\t%d\t%s\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%s\n",
+           info[i].pid, info[i].ppid, info[i].pgid, info[i].state, info[i].nice,
+           info[i].rtprio, info[i].cputicks, info[i].waitticks,
+           info[i].nswitch, info[i].nsignals, info[i].sz, info[i].name);
+  exit();
+}
@@ -0,0 +1,94 @@
+// Measure how quickly a process blocked in read() gets the CPU
+// after being signalled and woken while CPU hogs keep every core
+// busy: first as a normal process, then as a SCHED_FIFO one.
+// Latencies are in TSC cycles, from kill() to the handler running.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "x86.h"
+
+#define NHOG    4
+#define NTRIAL  20
+#define SIGPING 10
+
+static volatile uint handled;
+
+void
+ping(int signum)
+{
+  handled = rdtsc();
+}
+
+// Fork a child that waits for NTRIAL pings and reports the mean
+// and worst latency it saw.
+void
+measure(int rt)
+{
+  int req[2], res[2], pid, i, n;
+  uint t0, lat, sum, max, r[2];
+
+  if(pipe(req) < 0 || pipe(res) < 0){
+    printf(2, "rtbench: pipe failed\n");
+    exit();
+  }
+  pid = fork();
+  if(pid == 0){
+    if(rt && setscheduler(0, SCHED_FIFO, 50) < 0)
+      printf(2, "rtbench: setscheduler failed\n");
+    signal(SIGPING, ping);
+    sum = max = 0;
+    for(i = 0; i < NTRIAL; i++){
+      // The ping itself interrupts the read: go back for the data.
+      while((n = read(req[0], &t0, sizeof(t0))) < 0)
+        ;
+      if(n != sizeof(t0))
+        break;
+      lat = handled - t0;
+      sum += lat;
+      if(lat > max)
+        max = lat;
+    }
+    r[0] = sum / NTRIAL;
+    r[1] = max;
+    write(res[1], r, sizeof(r));
+    exit();
+  }
+
+  for(i = 0; i < NTRIAL; i++){
+    sleep(2);  // let the child block in read()
+    t0 = rdtsc();
+    kill(pid, SIGPING);
+    write(req[1], &t0, sizeof(t0));
+  }
+  if(read(res[0], r, sizeof(r)) == sizeof(r))
+    printf(1, "%s: mean %d cycles, worst %d cycles\n",
+           rt ? "SCHED_FIFO " : "SCHED_OTHER", r[0], r[1]);
+  wait();
+  close(req[0]);
+  close(req[1]);
+  close(res[0]);
+  close(res[1]);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int hogs[NHOG], i;
+
+  for(i = 0; i < NHOG; i++){
+    if((hogs[i] = fork()) == 0)
+      for(;;)
+        ;
+  }
+
+  measure(0);
+  measure(1);
+
+  for(i = 0; i < NHOG; i++){
+    kill(hogs[i], SIG_KILL);
+    wait();
+  }
+  exit();
+}
@@ -145,7 +145,7 @@ int
 main(void)
 {
   static char buf[100];
-  int fd;
+  int fd, pid;
 
   // Ensure that three file descriptors are open.
   while((fd = open("console", O_RDWR)) >= 0){
@@ -164,8 +164,13 @@ main(void)
         printf(2, "cannot cd %s\n", buf+3);
       continue;
     }
-    if(fork1() == 0)
+    // Each command line runs in its own process group, so that
+    // kill(-pgid, sig) reaches every stage of a pipeline.
+    if((pid = fork1()) == 0){
+      setpgid(0, 0);
       runcmd(parsecmd(buf));
+    }
+    setpgid(pid, pid);
     wait();
   }
   exit();
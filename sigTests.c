@@ -2,6 +2,8 @@
 #include "param.h"
 #include "user.h"
 #include "stat.h"
+#include "x86.h"
+#include "procinfo.h"
 
 
 
@@ -57,6 +59,121 @@ void pre_test(sighandler_t old_handler){
 	printf(2, "---------------HANDLERS_CHECK end------------------\n\n");
 }
 
+#define NKIDS 20
+
+// Kill a batch of spinning children by pid, check that wait() hands
+// back exactly those pids and that a reaped pid can't be signalled.
+void pid_lookup_test(void){
+	int pids[NKIDS], i, j, pid, found;
+
+	printf(2, "---------------PID_LOOKUP start----------------------\n");
+	for (i=0; i<NKIDS; i++){
+		if ((pids[i] = fork()) == 0){
+			for (;;)
+				count_proc();
+		}
+	}
+	for (i=0; i<NKIDS; i++){
+		if (kill(pids[i], SIG_KILL) < 0)
+			printf(2, "kill(%d) failed\n", pids[i]);
+	}
+	for (i=0; i<NKIDS; i++){
+		pid = wait();
+		found = 0;
+		for (j=0; j<NKIDS; j++){
+			if (pids[j] == pid){
+				pids[j] = -pid;
+				found = 1;
+			}
+		}
+		if (!found)
+			printf(2, "wait returned unexpected pid %d\n", pid);
+	}
+	for (i=0; i<NKIDS; i++){
+		if (kill(-pids[i], SIG_KILL) != -1)
+			printf(2, "kill of reaped pid %d succeeded\n", -pids[i]);
+	}
+	if (kill(getpid() + 100000, SIG_KILL) != -1)
+		printf(2, "kill of unused pid succeeded\n");
+	printf(2, "---------------PID_LOOKUP end------------------------\n\n");
+}
+
+// Put a pool of spinning workers in a group of their own and
+// stop them all with a single kill(-pgid).
+void pgrp_test(void){
+	int pids[NKIDS], i, pgid;
+
+	printf(2, "---------------PGRP start----------------------------\n");
+	for (i=0; i<NKIDS; i++){
+		if ((pids[i] = fork()) == 0){
+			for (;;)
+				count_proc();
+		}
+		if (setpgid(pids[i], pids[0]) < 0)
+			printf(2, "setpgid(%d, %d) failed\n", pids[i], pids[0]);
+	}
+	pgid = getpgid(pids[NKIDS-1]);
+	if (pgid != pids[0])
+		printf(2, "worker in group %d, expected %d\n", pgid, pids[0]);
+	if (getpgid(0) == pgid)
+		printf(2, "parent joined the workers' group\n");
+	if (kill(-pgid, SIG_KILL) < 0)
+		printf(2, "kill(-%d) failed\n", pgid);
+	for (i=0; i<NKIDS; i++)
+		if (wait() < 0)
+			printf(2, "only %d workers exited\n", i);
+	if (kill(-pgid, SIG_KILL) != -1)
+		printf(2, "kill of an empty group succeeded\n");
+	printf(2, "---------------PGRP end------------------------------\n\n");
+}
+
+static struct procinfo info[NPROC];
+
+// Fill *pi with pid's accounting; returns 0 if pid is gone.
+int find_proc(int pid, struct procinfo *pi){
+	int i, n;
+
+	n = getprocinfo(info, NPROC);
+	for (i=0; i<n; i++){
+		if (info[i].pid == pid){
+			*pi = info[i];
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// A stopped process must sit in the STOPPED state without being
+// scheduled, and run again after SIGCONT.
+void stop_test(void){
+	struct procinfo before, after;
+	int child;
+
+	printf(2, "---------------STOP start----------------------------\n");
+	if ((child = fork()) == 0){
+		for (;;)
+			count_proc();
+	}
+	sleep(2);
+	kill(child, SIGSTOP);
+	sleep(2);
+	find_proc(child, &before);
+	sleep(10);
+	find_proc(child, &after);
+	if (strcmp(after.state, "stopped") != 0)
+		printf(2, "stopped child is %s\n", after.state);
+	if (after.nswitch != before.nswitch)
+		printf(2, "stopped child was scheduled %d times\n", after.nswitch - before.nswitch);
+	kill(child, SIGCONT);
+	sleep(5);
+	find_proc(child, &after);
+	if (after.cputicks == before.cputicks)
+		printf(2, "child did not run after SIGCONT\n");
+	kill(child, SIG_KILL);
+	wait();
+	printf(2, "---------------STOP end------------------------------\n\n");
+}
+
 void looping_sigprocmask_test(int parent){
 	int i;
 	for (i=0; i < 32; i++)
@@ -68,12 +185,247 @@ void looping_sigprocmask_test(int parent){
 		kill(parent, i);
 }
 
+#define NBURST 8
+#define SIGBURST 20
+
+static volatile int burst_count;
+
+void burst_handler(int n){
+	burst_count++;
+}
+
+// Queue NBURST signals behind the mask, then unmask them all at
+// once: every handler must have run when sigprocmask() returns.
+void signal_burst_test(void){
+	uint mask, t0, t1;
+	int i;
+
+	printf(2, "---------------SIGNAL_BURST start--------------------\n");
+	mask = 0;
+	for (i=0; i<NBURST; i++){
+		signal(SIGBURST+i, burst_handler);
+		mask |= 1 << (SIGBURST+i);
+	}
+	burst_count = 0;
+	sigprocmask(mask);
+	for (i=0; i<NBURST; i++)
+		kill(getpid(), SIGBURST+i);
+	t0 = rdtsc();
+	sigprocmask(0);
+	t1 = rdtsc();
+	if (burst_count != NBURST)
+		printf(2, "only %d of %d signals handled\n", burst_count, NBURST);
+	else
+		printf(2, "%d signals handled in %d cycles\n", NBURST, t1 - t0);
+	for (i=0; i<NBURST; i++)
+		signal(SIGBURST+i, (sighandler_t)SIG_DFL);
+	printf(2, "---------------SIGNAL_BURST end----------------------\n\n");
+}
+
+#define NQUEUED 5
+
+static volatile int queued_values[NSIGQ];
+static volatile int queued_count;
+
+void queued_handler(int signum, int value){
+	queued_values[queued_count++] = value;
+}
+
+// Real-time signals sent while masked must all arrive, in order,
+// each with its value; kill() of one queues it with value 0.
+void sigqueue_test(void){
+	int i, n;
+
+	printf(2, "---------------SIGQUEUE start------------------------\n");
+	signal(SIGRTMIN, (sighandler_t)queued_handler);
+	queued_count = 0;
+	sigprocmask(1 << SIGRTMIN);
+	for (i=1; i<=NQUEUED; i++)
+		if (sigqueue(getpid(), SIGRTMIN, i) < 0)
+			printf(2, "sigqueue %d failed\n", i);
+	kill(getpid(), SIGRTMIN);
+	for (n=NQUEUED+1; sigqueue(getpid(), SIGRTMIN, -1) == 0; n++)
+		;
+	if (n != NSIGQ)
+		printf(2, "queue took %d signals, expected %d\n", n, NSIGQ);
+	sigprocmask(0);
+	if (queued_count != NSIGQ)
+		printf(2, "%d of %d queued signals handled\n", queued_count, NSIGQ);
+	for (i=0; i<NQUEUED; i++)
+		if (queued_values[i] != i+1)
+			printf(2, "signal %d carried %d, expected %d\n", i, queued_values[i], i+1);
+	if (queued_values[NQUEUED] != 0)
+		printf(2, "kill() signal carried %d\n", queued_values[NQUEUED]);
+	if (sigqueue(getpid(), SIG_KILL, 0) != -1)
+		printf(2, "sigqueue of a non real-time signal succeeded\n");
+	signal(SIGRTMIN, (sighandler_t)SIG_DFL);
+	printf(2, "---------------SIGQUEUE end--------------------------\n\n");
+}
+
+static volatile int intr_count;
+
+void intr_handler(int n){
+	intr_count++;
+}
+
+// A signal with a handler must cut short a blocked pipe read and a
+// long sleep(), each returning -1 once the handler has run.
+void intr_test(void){
+	int fds[2], parent, child;
+	char c;
+
+	printf(2, "---------------INTR start----------------------------\n");
+	signal(SIGBURST, intr_handler);
+	intr_count = 0;
+	pipe(fds);
+	parent = getpid();
+	if ((child = fork()) == 0){
+		sleep(5);
+		kill(parent, SIGBURST);
+		sleep(5);
+		kill(parent, SIGBURST);
+		exit();
+	}
+	if (read(fds[0], &c, 1) != -1)
+		printf(2, "pipe read was not interrupted\n");
+	if (sleep(1000) != -1)
+		printf(2, "sleep was not interrupted\n");
+	if (intr_count != 2)
+		printf(2, "handler ran %d times, expected 2\n", intr_count);
+	wait();
+	close(fds[0]);
+	close(fds[1]);
+	signal(SIGBURST, (sighandler_t)SIG_DFL);
+	printf(2, "---------------INTR end------------------------------\n\n");
+}
+
+// sigwait() must consume masked signals, with their payloads,
+// without running their handlers; sigtimedwait() must time out.
+void sigwait_test(void){
+	uint mask;
+	int parent, child, signum, value;
+
+	printf(2, "---------------SIGWAIT start-------------------------\n");
+	signal(SIGBURST, intr_handler);
+	signal(SIGRTMIN, intr_handler);
+	intr_count = 0;
+	mask = (1 << SIGBURST) | (1 << SIGRTMIN);
+	sigprocmask(mask);
+	parent = getpid();
+	if ((child = fork()) == 0){
+		sleep(5);
+		sigqueue(parent, SIGRTMIN, 42);
+		sleep(5);
+		kill(parent, SIGBURST);
+		exit();
+	}
+	signum = sigwait(mask, &value);
+	if (signum != SIGRTMIN || value != 42)
+		printf(2, "sigwait got %d (%d), expected %d (42)\n", signum, value, SIGRTMIN);
+	signum = sigwait(mask, &value);
+	if (signum != SIGBURST || value != 0)
+		printf(2, "sigwait got %d (%d), expected %d (0)\n", signum, value, SIGBURST);
+	if (sigtimedwait(mask, 0, 5) != -1)
+		printf(2, "sigtimedwait did not time out\n");
+	wait();
+	sigprocmask(0);
+	if (intr_count != 0)
+		printf(2, "handler ran %d times for waited signals\n", intr_count);
+	signal(SIGBURST, (sighandler_t)SIG_DFL);
+	signal(SIGRTMIN, (sighandler_t)SIG_DFL);
+	printf(2, "---------------SIGWAIT end---------------------------\n\n");
+}
+
+// alarm() must post SIGALRM to a sleeping process; setitimer()
+// must keep posting it until disarmed, several times a tick if
+// asked to.
+void alarm_test(void){
+	int n, t;
+
+	printf(2, "---------------ALARM start---------------------------\n");
+	signal(SIGALRM, intr_handler);
+	intr_count = 0;
+	alarm(100);
+	if ((n = alarm(3)) <= 0 || n > 100)
+		printf(2, "alarm returned %d ticks left, expected up to 100\n", n);
+	if (sleep(100) != -1 || intr_count != 1)
+		printf(2, "alarm did not interrupt sleep\n");
+	setitimer(2*ITIMERRES, 2*ITIMERRES);
+	for (n = 0; n < 1000 && intr_count < 4; n++)
+		sleep(1);
+	if (setitimer(0, 0) <= 0 || intr_count < 4)
+		printf(2, "interval timer fired %d times\n", intr_count - 1);
+	intr_count = 0;
+	setitimer(ITIMERRES/4, ITIMERRES/4);
+	t = uptime() + 10;
+	while (uptime() < t)
+		;
+	setitimer(0, 0);
+	if (intr_count <= 20)
+		printf(2, "quarter-tick timer fired %d times in 10 ticks\n", intr_count);
+	if (alarm(0) != 0)
+		printf(2, "timer still armed\n");
+	signal(SIGALRM, (sighandler_t)SIG_DFL);
+	printf(2, "---------------ALARM end-----------------------------\n\n");
+}
+
+#define SIGOUTER 12
+#define SIGINNER 13
+
+static char altstack[4096];
+static volatile uint outer_sp, inner_sp;
+
+void inner_handler(int n){
+	int here;
+	inner_sp = (uint)&here;
+}
+
+void outer_handler(int n){
+	int here;
+	outer_sp = (uint)&here;
+	kill(getpid(), SIGINNER);  // nests on the way out of kill()
+}
+
+// Handlers must run on the sigaltstack(), and a handler that
+// interrupts another must nest below it on the same stack.
+void altstack_test(void){
+	uint lo, hi;
+
+	printf(2, "---------------ALTSTACK start------------------------\n");
+	if (sigaltstack(altstack, 16) != -1)
+		printf(2, "sigaltstack took a tiny stack\n");
+	if (sigaltstack(altstack, sizeof(altstack)) < 0)
+		printf(2, "sigaltstack failed\n");
+	signal(SIGOUTER, outer_handler);
+	signal(SIGINNER, inner_handler);
+	outer_sp = inner_sp = 0;
+	kill(getpid(), SIGOUTER);
+	lo = (uint)altstack;
+	hi = lo + sizeof(altstack);
+	if (outer_sp < lo || outer_sp >= hi)
+		printf(2, "handler ran at %x, off the signal stack\n", outer_sp);
+	if (inner_sp < lo || inner_sp >= outer_sp)
+		printf(2, "nested handler ran at %x, not below %x\n", inner_sp, outer_sp);
+	sigaltstack(0, 0);
+	signal(SIGOUTER, (sighandler_t)SIG_DFL);
+	signal(SIGINNER, (sighandler_t)SIG_DFL);
+	printf(2, "---------------ALTSTACK end--------------------------\n\n");
+}
 
 int main(int argc, char **argv){
 	int child, parent;
 	//kind of pre testing data
 	sighandler_t old_handler = signal(0, first_proc_print);
 	pre_test(old_handler);
+	pid_lookup_test();
+	signal_burst_test();
+	sigqueue_test();
+	pgrp_test();
+	stop_test();
+	intr_test();
+	sigwait_test();
+	alarm_test();
+	altstack_test();
 	//-------------------------
 	if ((child = fork()) == 0){
 		count_proc();
@@ -100,7 +452,9 @@ int main(int argc, char **argv){
 		signal(SIG_KILL, first_proc_print);
 		kill(child, SIGCONT);
 		count_proc();
-		wait();
+		// The child's handled SIG_KILL may interrupt wait().
+		while (wait() != child)
+			;
 		printf(2, "Parent prints this after activating first_proc_print\n");
 		signal(SIG_KILL, (sighandler_t)SIG_DFL);
 	}
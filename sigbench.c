@@ -0,0 +1,67 @@
+// Measure signal round-trip latency: kill() ourselves, run a
+// trivial handler and return through sigret(), back in the
+// caller. Then the same with the signal masked and consumed by
+// sigtimedwait() instead. Reports the mean and best time in TSC
+// cycles.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "x86.h"
+
+#define NTRIAL  1000
+#define SIGPING 10
+
+static volatile int handled;
+
+void
+ping(int signum)
+{
+  handled++;
+}
+
+int
+main(int argc, char *argv[])
+{
+  uint t0, lat, sum, best;
+  int i, pid, waited;
+
+  signal(SIGPING, ping);
+  pid = getpid();
+  sum = 0;
+  best = ~0;
+  for(i = 0; i < NTRIAL; i++){
+    t0 = rdtsc();
+    kill(pid, SIGPING);  // delivered on the way out of kill()
+    lat = rdtsc() - t0;
+    sum += lat;
+    if(lat < best)
+      best = lat;
+  }
+  if(handled != NTRIAL)
+    printf(2, "sigbench: %d of %d signals handled\n", handled, NTRIAL);
+  printf(1, "signal round trip: mean %d cycles, best %d cycles\n",
+         sum / NTRIAL, best);
+
+  sigprocmask(1 << SIGPING);
+  sum = 0;
+  best = ~0;
+  waited = 0;
+  for(i = 0; i < NTRIAL; i++){
+    t0 = rdtsc();
+    kill(pid, SIGPING);
+    if(sigtimedwait(1 << SIGPING, 0, 0) == SIGPING)
+      waited++;
+    lat = rdtsc() - t0;
+    sum += lat;
+    if(lat < best)
+      best = lat;
+  }
+  sigprocmask(0);
+  if(waited != NTRIAL || handled != NTRIAL)
+    printf(2, "sigbench: %d of %d signals waited for\n", waited, NTRIAL);
+  printf(1, "kill + sigtimedwait: mean %d cycles, best %d cycles\n",
+         sum / NTRIAL, best);
+  exit();
+}
@@ -24,7 +24,7 @@ acquiresleep(struct sleeplock *lk)
 {
   acquire(&lk->lk);
   while (lk->locked) {
-    sleep(lk, &lk->lk);
+    sleepexcl(lk, &lk->lk);
   }
   lk->locked = 1;
   lk->pid = myproc()->pid;
@@ -37,7 +37,7 @@ releasesleep(struct sleeplock *lk)
   acquire(&lk->lk);
   lk->locked = 0;
   lk->pid = 0;
-  wakeup(lk);
+  wakeupone(lk);
   release(&lk->lk);
 }
 
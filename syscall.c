@@ -106,6 +106,23 @@ extern int sys_uptime(void);
 extern int sys_sigprocmask(void);
 extern int sys_signal(void);
 extern int sys_sigret(void);
+extern int sys_setpriority(void);
+extern int sys_setscheduler(void);
+extern int sys_getprocinfo(void);
+extern int sys_setaffinity(void);
+extern int sys_getaffinity(void);
+extern int sys_clone(void);
+extern int sys_join(void);
+extern int sys_futex_wait(void);
+extern int sys_futex_wake(void);
+extern int sys_sigqueue(void);
+extern int sys_setpgid(void);
+extern int sys_getpgid(void);
+extern int sys_sigwait(void);
+extern int sys_sigtimedwait(void);
+extern int sys_alarm(void);
+extern int sys_setitimer(void);
+extern int sys_sigaltstack(void);
 
 static int (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -132,6 +149,23 @@ static int (*syscalls[])(void) = {
 [SYS_sigprocmask]   sys_sigprocmask,
 [SYS_signal]  sys_signal,
 [SYS_sigret]  sys_sigret,
+[SYS_setpriority] sys_setpriority,
+[SYS_setscheduler] sys_setscheduler,
+[SYS_getprocinfo] sys_getprocinfo,
+[SYS_setaffinity] sys_setaffinity,
+[SYS_getaffinity] sys_getaffinity,
+[SYS_clone]   sys_clone,
+[SYS_join]    sys_join,
+[SYS_futex_wait] sys_futex_wait,
+[SYS_futex_wake] sys_futex_wake,
+[SYS_sigqueue] sys_sigqueue,
+[SYS_setpgid] sys_setpgid,
+[SYS_getpgid] sys_getpgid,
+[SYS_sigwait] sys_sigwait,
+[SYS_sigtimedwait] sys_sigtimedwait,
+[SYS_alarm] sys_alarm,
+[SYS_setitimer] sys_setitimer,
+[SYS_sigaltstack] sys_sigaltstack,
 };
 
 void
@@ -23,4 +23,21 @@
 //Creation of new system calls
 #define SYS_sigprocmask  22
 #define SYS_signal   23
-#define SYS_sigret   24
\ No newline at end of file
+#define SYS_sigret   24
+#define SYS_setpriority 25
+#define SYS_setscheduler 26
+#define SYS_getprocinfo 27
+#define SYS_setaffinity 28
+#define SYS_getaffinity 29
+#define SYS_clone  30
+#define SYS_join   31
+#define SYS_futex_wait 32
+#define SYS_futex_wake 33
+#define SYS_sigqueue 34
+#define SYS_setpgid 35
+#define SYS_getpgid 36
+#define SYS_sigwait 37
+#define SYS_sigtimedwait 38
+#define SYS_alarm 39
+#define SYS_setitimer 40
+#define SYS_sigaltstack 41
@@ -6,6 +6,7 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "proc.h"
+#include "procinfo.h"
 
 int
 sys_fork(void)
@@ -50,8 +51,7 @@ sys_sbrk(void)
 
   if(argint(0, &n) < 0)
     return -1;
-  addr = myproc()->sz;
-  if(growproc(n) < 0)
+  if((addr = growproc(n)) < 0)
     return -1;
   return addr;
 }
@@ -60,22 +60,10 @@ int
 sys_sleep(void)
 {
   int n;
-  uint ticks0;
 
   if(argint(0, &n) < 0)
     return -1;
-  acquire(&tickslock);
-  ticks0 = ticks;
-  while(ticks - ticks0 < n){
-    if(myproc()->killed){
-      release(&tickslock);
-      return -1;
-    }
-
-    sleep(&ticks, &tickslock);
-  }
-  release(&tickslock);
-  return 0;
+  return sleepticks(n);
 }
 
 // return how many clock tick interrupts have occurred
@@ -115,7 +103,188 @@ int
 sys_sigret(void)
 {
     sigret();
-    return 0;
+    return myproc()->tf->eax;  // syscall() stores this back in eax
+
+}
+
+int
+sys_setpriority(void)
+{
+    int pid, nice;
+    if(argint(0, &pid) < 0 || argint(1, &nice) < 0)
+        return -1;
+    return setpriority(pid, nice);
+}
+
+int
+sys_setscheduler(void)
+{
+    int pid, policy, prio;
+    if(argint(0, &pid) < 0 || argint(1, &policy) < 0 || argint(2, &prio) < 0)
+        return -1;
+    return setscheduler(pid, policy, prio);
+}
+
+int
+sys_getprocinfo(void)
+{
+    struct procinfo *info;
+    int n;
+    if(argint(1, &n) < 0 || n < 0)
+        return -1;
+    // There are never more than NPROC to report; clamping also
+    // keeps n*sizeof(*info) from overflowing past argptr's check.
+    if(n > NPROC)
+        n = NPROC;
+    if(argptr(0, (char**)&info, n*sizeof(*info)) < 0)
+        return -1;
+    return getprocinfo(info, n);
+}
+
+int
+sys_setaffinity(void)
+{
+    int pid, mask;
+    if(argint(0, &pid) < 0 || argint(1, &mask) < 0)
+        return -1;
+    return setaffinity(pid, mask);
+}
+
+int
+sys_getaffinity(void)
+{
+    int pid;
+    if(argint(0, &pid) < 0)
+        return -1;
+    return getaffinity(pid);
+}
+
+int
+sys_clone(void)
+{
+    int fcn, arg1, arg2, stack;
+    if(argint(0, &fcn) < 0 || argint(1, &arg1) < 0 ||
+       argint(2, &arg2) < 0 || argint(3, &stack) < 0)
+        return -1;
+    return clone((void(*)(void*,void*))fcn, (void*)arg1, (void*)arg2, (void*)stack);
+}
+
+int
+sys_setpgid(void)
+{
+    int pid, pgid;
+    if(argint(0, &pid) < 0 || argint(1, &pgid) < 0)
+        return -1;
+    return setpgid(pid, pgid);
+}
+
+int
+sys_getpgid(void)
+{
+    int pid;
+    if(argint(0, &pid) < 0)
+        return -1;
+    return getpgid(pid);
+}
 
+int
+sys_sigqueue(void)
+{
+    int pid, signum, value;
+    if(argint(0, &pid) < 0 || argint(1, &signum) < 0 || argint(2, &value) < 0)
+        return -1;
+    return sigqueue(pid, signum, value);
+}
+
+// The payload goes to *value unless value is 0.
+static int
+sigwaitargs(uint *mask, int **value)
+{
+    int addr;
+    static int discard;
+    if(argint(0, (int*)mask) < 0 || argint(1, &addr) < 0)
+        return -1;
+    if(addr == 0){
+        *value = &discard;
+        return 0;
+    }
+    return argptr(1, (char**)value, sizeof(**value));
+}
+
+int
+sys_sigwait(void)
+{
+    uint mask;
+    int *value;
+    if(sigwaitargs(&mask, &value) < 0)
+        return -1;
+    return sigtimedwait(mask, value, -1);
+}
+
+int
+sys_sigtimedwait(void)
+{
+    uint mask;
+    int *value, ticks;
+    if(sigwaitargs(&mask, &value) < 0 || argint(2, &ticks) < 0)
+        return -1;
+    return sigtimedwait(mask, value, ticks);
+}
+
+int
+sys_sigaltstack(void)
+{
+    int sp, size;
+    if(argint(0, &sp) < 0 || argint(1, &size) < 0)
+        return -1;
+    return sigaltstack(sp, size);
+}
+
+int
+sys_alarm(void)
+{
+    int n;
+    if(argint(0, &n) < 0 || n < 0 || n > 0x7FFFFFFF / ITIMERRES)
+        return -1;
+    // In ticks: round what was left up to whole ones.
+    return (setitimer(n * ITIMERRES, 0) + ITIMERRES - 1) / ITIMERRES;
+}
+
+int
+sys_setitimer(void)
+{
+    int value, interval;
+    if(argint(0, &value) < 0 || argint(1, &interval) < 0)
+        return -1;
+    return setitimer(value, interval);
+}
+
+int
+sys_join(void)
+{
+    void **stack;
+    if(argptr(0, (char**)&stack, sizeof(*stack)) < 0)
+        return -1;
+    return join(stack);
+}
+
+int
+sys_futex_wait(void)
+{
+    char *addr;
+    int val;
+    if(argptr(0, &addr, sizeof(uint)) < 0 || argint(1, &val) < 0)
+        return -1;
+    return futexwait((uint)addr, val);
+}
+
+int
+sys_futex_wake(void)
+{
+    char *addr;
+    int n;
+    if(argptr(0, &addr, sizeof(uint)) < 0 || argint(1, &n) < 0)
+        return -1;
+    return futexwake((uint)addr, n);
 }
 //=================================================================================================
\ No newline at end of file
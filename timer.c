@@ -0,0 +1,232 @@
+// Timer wheel for sleep() and interval timers.
+//
+// A process sleeping until tick t waits on wheel slot t % NWHEEL,
+// so each clock tick wakes only the sleepers whose deadline falls
+// in the current slot, plus any due a whole revolution later, which
+// go back to sleep. An interval timer due at tick t is likewise
+// chained on slot t % NWHEEL until it fires. The per-slot counts
+// and chains also tell an idle CPU 0 how long it may leave its
+// local APIC timer off (see cpuidle in proc.c).
+//
+// Interval timers have a finer resolution, 1/ITIMERRES of a tick.
+// One due part way through the current tick gets a T_SUBTICK
+// one-shot from CPU 0's local APIC timer (see lapicsubtick).
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+
+#define NWHEEL 128
+
+static struct {
+  char chan;            // sleep channel for this slot
+  uint nsleep;          // number of processes asleep on it
+  struct proc *alarms;  // interval timers due in this slot
+} wheel[NWHEEL];
+
+static int subarmed = -1;  // unit of this tick T_SUBTICK is set for, or -1
+
+// Sleep for n ticks. Returns -1 if the process is killed or a
+// signal it would act on arrives first.
+int
+sleepticks(int n)
+{
+  uint deadline;
+  int slot;
+
+  if(n <= 0)
+    return 0;
+  acquire(&tickslock);
+  deadline = ticks + n;
+  slot = deadline % NWHEEL;
+  wheel[slot].nsleep++;
+  while((int)(deadline - ticks) > 0){
+    // Killed or signalled: give up early.
+    if(sleepintr(&wheel[slot].chan, &tickslock, 0) < 0){
+      wheel[slot].nsleep--;
+      release(&tickslock);
+      return -1;
+    }
+  }
+  wheel[slot].nsleep--;
+  release(&tickslock);
+  return 0;
+}
+
+// Chain p's interval timer on the wheel, due sub units into
+// tick t. Caller holds tickslock.
+static void
+alarmarm(struct proc *p, uint t, int sub)
+{
+  int slot = t % NWHEEL;
+
+  p->alarmset = 1;
+  p->alarmtick = t;
+  p->alarmsub = sub;
+  p->alarmnext = wheel[slot].alarms;
+  wheel[slot].alarms = p;
+}
+
+// Take p's interval timer off the wheel. Caller holds tickslock.
+static void
+alarmdisarm(struct proc *p)
+{
+  struct proc **pp;
+
+  if(!p->alarmset)
+    return;
+  for(pp = &wheel[p->alarmtick % NWHEEL].alarms; *pp; pp = &(*pp)->alarmnext){
+    if(*pp == p){
+      *pp = p->alarmnext;
+      break;
+    }
+  }
+  p->alarmset = 0;
+}
+
+// Post SIGALRM to the processes whose timers are due in the
+// current tick, up to unit upto of it, and rearm the periodic ones
+// an interval after they were due, so that they do not drift.
+// Then set up a T_SUBTICK for the next timer due later in the
+// tick, or fire it at once if that time has already passed.
+// Runs on CPU 0; caller holds tickslock.
+static void
+alarmfire(int upto)
+{
+  struct proc **pp, *p;
+  int next, fired, sub;
+
+  for(;;){
+    next = ITIMERRES;
+    fired = 0;
+    pp = &wheel[ticks % NWHEEL].alarms;
+    while((p = *pp) != 0){
+      if(p->alarmtick != ticks || p->alarmsub > upto){
+        if(p->alarmtick == ticks && p->alarmsub < next)
+          next = p->alarmsub;
+        pp = &p->alarmnext;
+        continue;
+      }
+      *pp = p->alarmnext;
+      p->alarmset = 0;
+      sendsig(p, SIGALRM);
+      fired = 1;
+      if(p->alarminterval > 0){
+        sub = p->alarmsub + p->alarminterval % ITIMERRES;
+        alarmarm(p, p->alarmtick + p->alarminterval / ITIMERRES + sub / ITIMERRES,
+                 sub % ITIMERRES);
+      }
+    }
+    if(fired)
+      continue;  // a rearmed timer may be due in this tick again
+    if(next == ITIMERRES)
+      return;
+    if(lapicsubtick(next) == 0){
+      subarmed = next;
+      return;
+    }
+    upto = next;
+  }
+}
+
+// Arm the current process's interval timer to post SIGALRM after
+// value, and every interval after that if interval is not 0, both
+// in units of 1/ITIMERRES of a tick. A value of 0 disarms it.
+// Like sleep(), the first expiry counts from the last clock tick,
+// and is never before the next one; later ones keep to the
+// interval exactly. Returns the time that was left on the old
+// timer, or 0 if it was not armed.
+int
+setitimer(int value, int interval)
+{
+  struct proc *p = myproc();
+  uint t;
+  int left, sub;
+
+  if(value < 0 || interval < 0)
+    return -1;
+  acquire(&tickslock);
+  left = 0;
+  if(p->alarmset)
+    left = (p->alarmtick - ticks) * ITIMERRES + p->alarmsub;
+  alarmdisarm(p);
+  p->alarminterval = interval;
+  if(value > 0){
+    t = ticks + value / ITIMERRES;
+    sub = value % ITIMERRES;
+    // Only CPU 0 can interrupt itself mid-tick: start at a tick.
+    if(t == ticks){
+      t++;
+      sub = 0;
+    }
+    alarmarm(p, t, sub);
+  }
+  release(&tickslock);
+  return left;
+}
+
+// T_SUBTICK on CPU 0: fire the timers due by now in this tick.
+void
+timersubtick(void)
+{
+  int upto;
+
+  lapicsubtickdone();
+  acquire(&tickslock);
+  upto = subarmed;
+  subarmed = -1;
+  if(upto >= 0)
+    alarmfire(upto);
+  release(&tickslock);
+}
+
+// Advance the clock by n ticks, waking the sleepers and firing
+// the timers in each slot passed over. Called on CPU 0 for every
+// clock interrupt, and after a tickless idle period with the ticks
+// it skipped.
+void
+timeradvance(uint n)
+{
+  acquire(&tickslock);
+  while(n-- > 0){
+    // A T_SUBTICK that never came (the timer was reprogrammed):
+    // fire the rest of this tick's timers late, not a revolution late.
+    if(subarmed >= 0){
+      subarmed = -1;
+      alarmfire(ITIMERRES - 1);
+    }
+    ticks++;
+    if(wheel[ticks % NWHEEL].nsleep > 0)
+      wakeup(&wheel[ticks % NWHEEL].chan);
+    // Ticks being made up after idle are over: fire all of theirs.
+    if(wheel[ticks % NWHEEL].alarms)
+      alarmfire(n > 0 ? ITIMERRES - 1 : 0);
+  }
+  release(&tickslock);
+}
+
+// Number of ticks until the next slot with sleepers or timers
+// comes round, or 0 if there are none. 1 while a T_SUBTICK is
+// pending, so that the clock is left alone.
+uint
+timernext(void)
+{
+  uint n, slot;
+
+  acquire(&tickslock);
+  if(subarmed >= 0){
+    release(&tickslock);
+    return 1;
+  }
+  for(n = 1; n <= NWHEEL; n++){
+    slot = (ticks + n) % NWHEEL;
+    if(wheel[slot].nsleep > 0 || wheel[slot].alarms)
+      break;
+  }
+  release(&tickslock);
+  return n > NWHEEL ? 0 : n;
+}
@@ -0,0 +1,72 @@
+// Show the processes using the most CPU, refreshed every second.
+// top [count]: stop after count refreshes (default 5).
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "procinfo.h"
+
+#define INTERVAL 100  // ticks between refreshes
+
+struct procinfo prev[NPROC], cur[NPROC];
+int pct[NPROC], order[NPROC];
+
+// CPU ticks pid used before the last refresh, or 0 if it is new.
+uint
+prevticks(int pid, int nprev)
+{
+  int i;
+
+  for(i = 0; i < nprev; i++)
+    if(prev[i].pid == pid)
+      return prev[i].cputicks;
+  return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int count, nprev, ncur, i, j, t, start, elapsed;
+
+  count = 5;
+  if(argc > 1)
+    count = atoi(argv[1]);
+
+  nprev = getprocinfo(prev, NPROC);
+  start = uptime();
+  while(count-- > 0){
+    sleep(INTERVAL);
+    ncur = getprocinfo(cur, NPROC);
+    elapsed = uptime() - start;
+    start = uptime();
+    if(elapsed <= 0)
+      elapsed = 1;
+
+    // Sort by CPU use over the interval, busiest first.
+    for(i = 0; i < ncur; i++){
+      pct[i] = (cur[i].cputicks - prevticks(cur[i].pid, nprev)) * 100 / elapsed;
+      order[i] = i;
+      for(j = i; j > 0 && pct[order[j]] > pct[order[j-1]]; j--){
+        t = order[j];
+        order[j] = order[j-1];
+        order[j-1] = t;
+      }
+    }
+
+    printf(1, "\n%d processes, %d ticks\n", ncur, elapsed);
+    printf(1, "PID\tSTATE\tNICE\t%%CPU\tCPU\tWAIT\tSWTCH\tSIGS\tNAME\n");
+    for(i = 0; i < ncur; i++){
+      j = order[i];
+      printf(1, "%d\t%s\t%d\t%d\t%d\t%d\t%d\t%d\t%s\n",
+             cur[j].pid, cur[j].state, cur[j].nice, pct[j],
+             cur[j].cputicks, cur[j].waitticks, cur[j].nswitch,
+             cur[j].nsignals, cur[j].name);
+    }
+
+    for(i = 0; i < ncur; i++)
+      prev[i] = cur[i];
+    nprev = ncur;
+  }
+  exit();
+}
@@ -11,36 +11,48 @@
 
 
 //=================SIGNALS HANDLER=================================================================
+// Deal with every pending, unmasked signal on this one return to
+// user space. They are taken lowest-numbered first with bsf, so
+// the user handlers run highest-numbered first: each one's frame
+// is stacked on the one before (see user_handler). Queued
+// real-time signals are stacked last, and so run first.
 void handleSignals(struct trapframe *tf){
   struct proc *p = myproc();
-  if(p == 0 || ((tf->cs & 3) != DPL_USER) || p->pending_signals == 0)
+  uint todo, done, cur_pending;
+  int signum, value;
+
+  if(p == 0 || ((tf->cs & 3) != DPL_USER))
     return;
-  int signum;
-  for (signum = 0; signum < 32 ; signum++){
-    int isSignaled = isBitOn(p->pending_signals,signum);
-    int isMasked = isBitOn(p->signal_mask,signum);
-    if(isSignaled && (!isMasked)){
-      p->signal_mask_backup = p->signal_mask;
-      p->signal_mask = setBit(p->signal_mask,signum);
-      if (p->signal_handlers[signum] == (void*)SIG_IGN){
-        uint cur_pending;
-        do{
-            cur_pending = p->pending_signals;
-        }while(!cas(&p->pending_signals, cur_pending, clearBit(cur_pending,signum)));
-        return;
-      }
-      else if(p->signal_handlers[signum] == (void*)SIG_DFL){//check if to mask?
-          default_handler(signum);
-          return;
-      }
-      else{
-          user_handler(signum);
-          return;
-      }
+  todo = p->pending_signals & ~p->signal_mask;
+  done = 0;
+  while(todo != 0 && !p->killed){
+    signum = bsf(todo);
+    todo &= todo - 1;
+    p->nsignals++;
+    if (p->signal_handlers[signum] == (void*)SIG_DFL){
+      default_handler(signum);  // clears its own pending bit
+      continue;
     }
-
+    done = setBit(done, signum);
+    if (p->signal_handlers[signum] != (void*)SIG_IGN && user_handler(signum, 0) < 0)
+      p->killed = 1;
+  }
+  if(done){
+    do{
+        cur_pending = p->pending_signals;
+    }while(!cas(&p->pending_signals, cur_pending, cur_pending & ~done));
   }
 
+  // Queued signals go in order, as far as the first masked one.
+  // A handler masks its own signal, so a second copy of the same
+  // signal waits for the first handler's sigret().
+  while(!p->killed && p->sigqhead != p->sigqtail && sigqget(&signum, &value)){
+    p->nsignals++;
+    if (p->signal_handlers[signum] == (void*)SIG_DFL)
+      default_handler(signum);
+    else if (p->signal_handlers[signum] != (void*)SIG_IGN && user_handler(signum, value) < 0)
+      p->killed = 1;
+  }
 }
 //=================================================================================================
 
@@ -81,19 +93,32 @@ trap(struct trapframe *tf)
     syscall();
     if(myproc()->killed)
       exit();
+    if(preemptpending())
+      yield();
     return;
   }
 
   switch(tf->trapno){
   case T_IRQ0 + IRQ_TIMER:
+    mycpu()->nticks++;
+    if(myproc() == 0)
+      mycpu()->idleticks++;
+    else
+      myproc()->cputicks++;
     if(cpuid() == 0){
-      acquire(&tickslock);
-      ticks++;
-      wakeup(&ticks);
-      release(&tickslock);
+      lapictick();
+      timeradvance(1);
     }
     lapiceoi();
     break;
+  case T_SUBTICK:
+    timersubtick();
+    lapiceoi();
+    break;
+  case T_RESCHED:
+    // Only needed to end a hlt in scheduler().
+    lapiceoi();
+    break;
   case T_IRQ0 + IRQ_IDE:
     ideintr();
     lapiceoi();
@@ -138,10 +163,12 @@ trap(struct trapframe *tf)
   if(myproc() && myproc()->killed && (tf->cs&3) == DPL_USER)
     exit();
 
-  // Force process to give up CPU on clock tick.
+  // Charge the process for the clock tick, and give up the CPU
+  // if a process that runs before it is waiting.
   // If interrupts were on while locks held, would need to check nlock.
+  // A real-time process woken by this interrupt preempts at once.
   if(myproc() && myproc()->state == RUNNING &&
-     tf->trapno == T_IRQ0+IRQ_TIMER)
+     ((tf->trapno == T_IRQ0+IRQ_TIMER && schedtick()) || preemptpending()))
     yield();
 
   // Check if the process has been killed since we yielded
@@ -25,6 +25,8 @@
 // These are arbitrarily chosen, but with care not to overlap
 // processor defined exceptions or interrupt vectors.
 #define T_SYSCALL       64      // system call
+#define T_RESCHED       65      // IPI: wake a halted CPU to reschedule
+#define T_SUBTICK       66      // CPU 0 timer: interval timer due mid-tick
 #define T_DEFAULT      500      // catchall
 
 #define T_IRQ0          32      // IRQ 0 corresponds to int T_IRQ
@@ -3,6 +3,8 @@
 #include "fcntl.h"
 #include "user.h"
 #include "x86.h"
+#include "mmu.h"
+#include "atomic.h"
 
 char*
 strcpy(char *s, char *t)
@@ -103,3 +105,142 @@ memmove(void *vdst, void *vsrc, int n)
     *dst++ = *src++;
   return vdst;
 }
+
+// Number of CPUs the caller may run on.
+int
+ncpus(void)
+{
+  uint mask;
+  int n;
+
+  mask = getaffinity(0);
+  for(n = 0; mask; mask &= mask - 1)
+    n++;
+  return n;
+}
+
+// Threads. Each gets a one-page stack from malloc(), with the
+// pointer to free stashed just below it. malloc() is not
+// thread-safe, so create and join threads from the main thread.
+
+static void
+threadstart(void *fn, void *arg)
+{
+  ((void (*)(void*))fn)(arg);
+  exit();
+}
+
+// Run fn(arg) in a new thread. Returns its pid, or -1.
+int
+thread_create(void (*fn)(void*), void *arg)
+{
+  char *mem, *stack;
+  int pid;
+
+  if((mem = malloc(2*PGSIZE + sizeof(char*))) == 0)
+    return -1;
+  stack = (char*)PGROUNDUP((uint)mem + sizeof(char*));
+  ((char**)stack)[-1] = mem;
+  if((pid = clone(threadstart, (void*)fn, arg, stack)) < 0)
+    free(mem);
+  return pid;
+}
+
+// Wait for a thread to finish and free its stack.
+// Returns its pid, or -1 if there are no threads.
+int
+thread_join(void)
+{
+  void *stack;
+  int pid;
+
+  if((pid = join(&stack)) >= 0)
+    free(((char**)stack)[-1]);
+  return pid;
+}
+
+void
+lock_init(lock_t *lk)
+{
+  lk->locked = 0;
+}
+
+// Spin on a plain read until the lock looks free, so waiters
+// do not keep pulling its cache line away from the holder.
+void
+lock_acquire(lock_t *lk)
+{
+  while(atomic_xchg(&lk->locked, 1) != 0)
+    atomic_spin(&lk->locked, 0);
+}
+
+void
+lock_release(lock_t *lk)
+{
+  atomic_xchg(&lk->locked, 0);
+}
+
+void
+mutex_init(mutex_t *m)
+{
+  m->state = 0;
+}
+
+// Take m with one cas when it is free. Otherwise mark it
+// contended and sleep until whoever holds it lets go.
+void
+mutex_lock(mutex_t *m)
+{
+  if(atomic_cas(&m->state, 0, 1))
+    return;
+  while(atomic_xchg(&m->state, 2) != 0)
+    futex_wait(&m->state, 2);
+}
+
+// Release m, entering the kernel only if someone may be waiting.
+void
+mutex_unlock(mutex_t *m)
+{
+  if(atomic_xchg(&m->state, 0) == 2)
+    futex_wake(&m->state, 1);
+}
+
+void
+cond_init(cond_t *c)
+{
+  c->seq = 0;
+  c->nwaiters = 0;
+}
+
+// Release m and wait for a signal, then retake m. Like any
+// condition variable it may wake spuriously; recheck the condition.
+void
+cond_wait(cond_t *c, mutex_t *m)
+{
+  uint seq;
+
+  atomic_fetch_add(&c->nwaiters, 1);
+  seq = c->seq;
+  mutex_unlock(m);
+  futex_wait(&c->seq, seq);
+  atomic_fetch_add(&c->nwaiters, -1);
+  // Others may have been woken with us; assume contention.
+  while(atomic_xchg(&m->state, 2) != 0)
+    futex_wait(&m->state, 2);
+}
+
+void
+cond_signal(cond_t *c)
+{
+  atomic_fetch_add(&c->seq, 1);
+  if(c->nwaiters > 0)
+    futex_wake(&c->seq, 1);
+}
+
+void
+cond_broadcast(cond_t *c)
+{
+  atomic_fetch_add(&c->seq, 1);
+  if(c->nwaiters > 0)
+    futex_wake(&c->seq, c->nwaiters);
+}
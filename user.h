@@ -1,5 +1,6 @@
 struct stat;
 struct rtcdate;
+struct procinfo;
 
 // system calls
 int fork(void);
@@ -26,6 +27,23 @@ int uptime(void);
 uint sigprocmask(uint sigmask);  //Task 2.1.3
 sighandler_t signal(int signum,sighandler_t handler); //Task 2.1.4
 void sigret(void); //Task 2.1.5
+int setpriority(int pid, int nice);
+int setscheduler(int pid, int policy, int prio);
+int getprocinfo(struct procinfo *info, int n);
+int setaffinity(int pid, uint mask);
+int getaffinity(int pid);
+int clone(void (*fcn)(void*, void*), void *arg1, void *arg2, void *stack);
+int join(void **stack);
+int futex_wait(volatile uint *addr, uint val);
+int futex_wake(volatile uint *addr, int n);
+int sigqueue(int pid, int signum, int value);  // handler gets (signum, value)
+int setpgid(int pid, int pgid);
+int getpgid(int pid);
+int sigwait(uint mask, int *value);  // consume a signal in mask, no handler
+int sigtimedwait(uint mask, int *value, int ticks);  // -1 after ticks
+int alarm(int ticks);  // SIGALRM after ticks; returns ticks left on old one
+int setitimer(int value, int interval);  // as alarm, in 1/ITIMERRES ticks, repeating
+int sigaltstack(void *stack, int size);  // run handlers on [stack, stack+size)
 
 // ulib.c
 int stat(char*, struct stat*);
@@ -40,3 +58,34 @@ void* memset(void*, int, uint);
 void* malloc(uint);
 void free(void*);
 int atoi(const char*);
+int ncpus(void);
+
+// threads, in ulib.c
+typedef struct {
+  volatile uint locked;
+} lock_t;
+
+int thread_create(void (*fn)(void*), void *arg);
+int thread_join(void);
+void lock_init(lock_t*);
+void lock_acquire(lock_t*);
+void lock_release(lock_t*);
+
+// Blocking locks and condition variables, in ulib.c. They enter
+// the kernel (futex_wait/futex_wake) only when contended.
+typedef struct {
+  volatile uint state;  // 0 free, 1 held, 2 held with waiters
+} mutex_t;
+
+typedef struct {
+  volatile uint seq;       // bumped by every signal or broadcast
+  volatile uint nwaiters;  // threads in cond_wait()
+} cond_t;
+
+void mutex_init(mutex_t*);
+void mutex_lock(mutex_t*);
+void mutex_unlock(mutex_t*);
+void cond_init(cond_t*);
+void cond_wait(cond_t*, mutex_t*);
+void cond_signal(cond_t*);
+void cond_broadcast(cond_t*);
@@ -7,6 +7,8 @@
 #include "syscall.h"
 #include "traps.h"
 #include "memlayout.h"
+#include "uthread.h"
+#include "procinfo.h"
 
 char buf[8192];
 char name[3];
@@ -1411,6 +1413,233 @@ forktest(void)
   printf(1, "fork test OK\n");
 }
 
+// threads share memory, and wait() does not see them
+#define NTHREAD 4
+lock_t clonelock;
+int clonecount;
+char *clonebrk[NTHREAD];
+
+void
+clonechild(void *arg)
+{
+  int i;
+
+  for(i = 0; i < 1000; i++){
+    lock_acquire(&clonelock);
+    clonecount++;
+    lock_release(&clonelock);
+  }
+  clonebrk[(int)arg] = sbrk(4096);
+  clonebrk[(int)arg][0] = (int)arg;
+}
+
+static struct procinfo affinfo[NPROC];
+
+// Pinning ourselves must move us to the new CPU at once.
+void
+affinitytest(void)
+{
+  uint all;
+  int i, j, n, me;
+
+  printf(1, "affinity test\n");
+  all = getaffinity(0);
+  me = getpid();
+  for(i = 0; i < 32; i++){
+    if(!(all & (1 << i)))
+      continue;
+    if(setaffinity(0, 1 << i) < 0 || getaffinity(0) != 1 << i){
+      printf(1, "setaffinity to cpu %d failed\n", i);
+      exit();
+    }
+    n = getprocinfo(affinfo, NPROC);
+    for(j = 0; j < n; j++){
+      if(affinfo[j].pid == me && affinfo[j].cpu != i){
+        printf(1, "pinned to cpu %d but on cpu %d\n", i, affinfo[j].cpu);
+        exit();
+      }
+    }
+  }
+  setaffinity(0, all);
+  printf(1, "affinity test OK\n");
+}
+
+void
+clonetest(void)
+{
+  int i;
+
+  printf(1, "clone test\n");
+  lock_init(&clonelock);
+  for(i = 0; i < NTHREAD; i++){
+    if(thread_create(clonechild, (void*)i) < 0){
+      printf(1, "thread_create failed\n");
+      exit();
+    }
+  }
+  if(wait() != -1){
+    printf(1, "wait returned a thread\n");
+    exit();
+  }
+  for(i = 0; i < NTHREAD; i++){
+    if(thread_join() < 0){
+      printf(1, "thread_join stopped early\n");
+      exit();
+    }
+  }
+  if(thread_join() != -1){
+    printf(1, "thread_join got too many\n");
+    exit();
+  }
+  if(clonecount != NTHREAD*1000){
+    printf(1, "clone count %d, expected %d\n", clonecount, NTHREAD*1000);
+    exit();
+  }
+  for(i = 0; i < NTHREAD; i++){
+    if(clonebrk[i][0] != i){
+      printf(1, "thread sbrk not shared\n");
+      exit();
+    }
+  }
+  printf(1, "clone test OK\n");
+}
+
+// producer/consumer threads with futex-based mutex and condvars
+#define NITEM 2000
+mutex_t pcmutex;
+cond_t pcnotempty, pcnotfull;
+int pcbuf[8], pccount, pcsum;
+
+void
+producer(void *arg)
+{
+  int i;
+
+  for(i = 1; i <= NITEM; i++){
+    mutex_lock(&pcmutex);
+    while(pccount == sizeof(pcbuf)/sizeof(pcbuf[0]))
+      cond_wait(&pcnotfull, &pcmutex);
+    pcbuf[pccount++] = i;
+    cond_signal(&pcnotempty);
+    mutex_unlock(&pcmutex);
+  }
+}
+
+void
+consumer(void *arg)
+{
+  int i;
+
+  for(i = 0; i < NITEM; i++){
+    mutex_lock(&pcmutex);
+    while(pccount == 0)
+      cond_wait(&pcnotempty, &pcmutex);
+    pcsum += pcbuf[--pccount];
+    cond_signal(&pcnotfull);
+    mutex_unlock(&pcmutex);
+  }
+}
+
+void
+futextest(void)
+{
+  uint word;
+  int i;
+
+  printf(1, "futex test\n");
+  word = 1;
+  if(futex_wait(&word, 0) != -1){
+    printf(1, "futex_wait slept on a stale value\n");
+    exit();
+  }
+  if(futex_wake(&word, 1) != 0){
+    printf(1, "futex_wake woke a phantom\n");
+    exit();
+  }
+  mutex_init(&pcmutex);
+  cond_init(&pcnotempty);
+  cond_init(&pcnotfull);
+  for(i = 0; i < 2; i++){
+    if(thread_create(producer, 0) < 0 || thread_create(consumer, 0) < 0){
+      printf(1, "thread_create failed\n");
+      exit();
+    }
+  }
+  while(thread_join() >= 0)
+    ;
+  if(pcsum != 2 * NITEM * (NITEM + 1) / 2){
+    printf(1, "futex sum %d, expected %d\n", pcsum, NITEM * (NITEM + 1));
+    exit();
+  }
+  printf(1, "futex test OK\n");
+}
+
+#define NUTEST 4
+
+static volatile int utorder[NUTEST*3], utn;
+static volatile int utspin;
+
+void
+utworker(void *arg)
+{
+  int i;
+
+  for(i = 0; i < 3; i++){
+    utorder[utn++] = (int)arg;
+    uthread_yield();
+  }
+}
+
+// Spins until the other spinner takes its turn: only preemption
+// gets them past each other.
+void
+utspinner(void *arg)
+{
+  int i;
+
+  for(i = 0; i < 3; i++){
+    while(utspin != (int)arg)
+      ;
+    utspin = !(int)arg;
+  }
+}
+
+void
+uthreadtest(void)
+{
+  int tids[NUTEST], i;
+
+  printf(1, "uthread test\n");
+  uthread_init(1);
+  for(i = 0; i < NUTEST; i++){
+    if((tids[i] = uthread_create(utworker, (void*)i)) < 0){
+      printf(1, "uthread_create failed\n");
+      exit();
+    }
+  }
+  for(i = 0; i < NUTEST; i++)
+    uthread_join(tids[i]);
+  // Round robin: each round runs every worker once, in order.
+  // (A preemption may let main in between, but not reorder them.)
+  for(i = 0; i < utn; i++){
+    if(utorder[i] != i % NUTEST){
+      printf(1, "uthread ran %d at step %d\n", utorder[i], i);
+      exit();
+    }
+  }
+  if(utn != NUTEST*3){
+    printf(1, "uthread workers ran %d times\n", utn);
+    exit();
+  }
+  tids[0] = uthread_create(utspinner, (void*)0);
+  tids[1] = uthread_create(utspinner, (void*)1);
+  uthread_join(tids[0]);
+  uthread_join(tids[1]);
+  setitimer(0, 0);
+  signal(SIGALRM, (sighandler_t)SIG_DFL);
+  printf(1, "uthread test OK\n");
+}
+
 void
 sbrktest(void)
 {
@@ -1793,6 +2022,10 @@ main(int argc, char *argv[])
   dirfile();
   iref();
   forktest();
+  affinitytest();
+  clonetest();
+  futextest();
+  uthreadtest();
   bigdir(); // slow
 
   uio();
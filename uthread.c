@@ -0,0 +1,168 @@
+// Green threads, scheduled round robin in user mode.
+//
+// A switch saves the callee-save registers on the old thread's
+// stack and loads the new one's (uswtch.S): no system call. With
+// a quantum, SIGALRM from setitimer() preempts the running thread:
+// its handler switches away on top of the signal frame, and when
+// the thread is picked again the handler returns through sigret()
+// into the interrupted code.
+//
+// The library's own state is guarded by inlib rather than by
+// masking signals, which would cost two system calls per switch:
+// a tick that finds inlib set does nothing, and the thread gets
+// preempted a quantum later. Preemption can interrupt other
+// library code, though; threads that share malloc() or printf()
+// state should yield rather than rely on the timer.
+
+#include "types.h"
+#include "user.h"
+#include "param.h"
+#include "uthread.h"
+
+#define USTACKSIZE 8192
+
+enum { UT_FREE, UT_RUNNABLE, UT_ZOMBIE };
+
+struct uthread {
+  int state;
+  uint sp;            // saved stack pointer, see uswtch
+  char *stack;        // kept for the next thread in this slot
+  void (*fn)(void*);
+  void *arg;
+};
+
+void uswtch(uint *oldsp, uint newsp);
+
+static struct uthread threads[NUTHREAD];  // threads[0] is main
+static struct uthread *cur = threads;
+static volatile int inlib;
+static uint basemask;  // signal mask threads run with
+
+// Switch to the next runnable thread after cur, if any. Called
+// with inlib set; clears it once this thread runs again.
+static void
+schedule(void)
+{
+  struct uthread *t, *prev;
+
+  t = cur;
+  do{
+    if(++t == &threads[NUTHREAD])
+      t = threads;
+  } while(t != cur && t->state != UT_RUNNABLE);
+  if(t != cur){
+    prev = cur;
+    cur = t;
+    uswtch(&prev->sp, t->sp);
+  } else if(cur->state != UT_RUNNABLE)
+    exit();
+  inlib = 0;
+}
+
+// SIGALRM handler. Runs on the preempted thread's stack, with
+// SIGALRM masked: unmask it for whichever thread runs next.
+static void
+preempt(int signum)
+{
+  if(inlib)
+    return;
+  inlib = 1;
+  sigprocmask(basemask);
+  schedule();
+}
+
+// First code run by a new thread, "returned" to by uswtch.
+static void
+uthread_start(void)
+{
+  inlib = 0;
+  cur->fn(cur->arg);
+  uthread_exit();
+}
+
+// Make the caller thread 0, and preempt threads every quantum
+// ticks, or only switch on yield if quantum is 0.
+void
+uthread_init(int quantum)
+{
+  threads[0].state = UT_RUNNABLE;
+  cur = threads;
+  if(quantum > 0){
+    basemask = sigprocmask(0) & ~(1 << SIGALRM);
+    sigprocmask(basemask);
+    signal(SIGALRM, preempt);
+    setitimer(quantum * ITIMERRES, quantum * ITIMERRES);
+  }
+}
+
+// Start fn(arg) in a new thread. Returns its id, or -1.
+int
+uthread_create(void (*fn)(void*), void *arg)
+{
+  struct uthread *t;
+  uint *sp;
+
+  inlib = 1;
+  for(t = &threads[1]; t < &threads[NUTHREAD]; t++)
+    if(t->state == UT_FREE)
+      break;
+  if(t == &threads[NUTHREAD] ||
+     (t->stack == 0 && (t->stack = malloc(USTACKSIZE)) == 0)){
+    inlib = 0;
+    return -1;
+  }
+  t->fn = fn;
+  t->arg = arg;
+  // A frame for uswtch to pop: registers, then its return address.
+  sp = (uint*)(t->stack + USTACKSIZE);
+  *--sp = 0;                    // uthread_start's return address
+  *--sp = (uint)uthread_start;
+  *--sp = 0;                    // ebp
+  *--sp = 0;                    // ebx
+  *--sp = 0;                    // esi
+  *--sp = 0;                    // edi
+  t->sp = (uint)sp;
+  t->state = UT_RUNNABLE;
+  inlib = 0;
+  return t - threads;
+}
+
+// Let the next runnable thread run.
+void
+uthread_yield(void)
+{
+  inlib = 1;
+  schedule();
+}
+
+// Wait for thread tid to finish, and free its slot.
+// Returns 0, or -1 if there is no such thread.
+int
+uthread_join(int tid)
+{
+  if(tid <= 0 || tid >= NUTHREAD || &threads[tid] == cur)
+    return -1;
+  while(threads[tid].state == UT_RUNNABLE)
+    uthread_yield();
+  if(threads[tid].state != UT_ZOMBIE)
+    return -1;
+  threads[tid].state = UT_FREE;
+  return 0;
+}
+
+// Finish the calling thread. In thread 0, exit the process.
+void
+uthread_exit(void)
+{
+  if(cur == threads)
+    exit();
+  inlib = 1;
+  cur->state = UT_ZOMBIE;
+  schedule();
+}
+
+int
+uthread_self(void)
+{
+  return cur - threads;
+}
@@ -0,0 +1,17 @@
+// Green threads: many threads in one process, switched in user
+// mode (M:1). See uthread.c.
+//
+// With a quantum, SIGALRM arrives every quantum ticks, and like any
+// handled signal it cuts short a blocking system call: sleep(),
+// wait(), join(), futex_wait() and pipe reads return -1, and a pipe
+// write returns what it wrote so far. Retry such calls, or mask
+// SIGALRM around them; a blocked call stops every thread anyway.
+
+#define NUTHREAD 16  // threads per process, including main
+
+void uthread_init(int quantum);
+int uthread_create(void (*fn)(void*), void *arg);
+void uthread_yield(void);
+int uthread_join(int tid);
+void uthread_exit(void);
+int uthread_self(void);
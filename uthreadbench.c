@@ -0,0 +1,61 @@
+// Compare context switch costs: two green threads yielding to
+// each other in user mode, against two processes passing a byte
+// back and forth over a pair of pipes, where every hand-off goes
+// through the kernel scheduler. Reports TSC cycles per switch.
+// Run with CPUS=1 for a like-for-like comparison: on more CPUs the
+// two processes can each spin up on their own CPU.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "x86.h"
+#include "uthread.h"
+
+#define NSWITCH 10000
+
+void
+pingpong(void *arg)
+{
+  int i;
+
+  for(i = 0; i < NSWITCH/2; i++)
+    uthread_yield();
+}
+
+int
+main(int argc, char *argv[])
+{
+  int a, b, i, pid, p2c[2], c2p[2];
+  uint t0, t1;
+  char c;
+
+  uthread_init(0);
+  a = uthread_create(pingpong, 0);
+  b = uthread_create(pingpong, 0);
+  t0 = rdtsc();
+  uthread_join(a);
+  uthread_join(b);
+  t1 = rdtsc();
+  printf(1, "uthread yield: %d cycles per switch\n", (t1 - t0) / NSWITCH);
+
+  if(pipe(p2c) < 0 || pipe(c2p) < 0){
+    printf(2, "uthreadbench: pipe failed\n");
+    exit();
+  }
+  if((pid = fork()) == 0){
+    for(i = 0; i < NSWITCH/2; i++){
+      read(p2c[0], &c, 1);
+      write(c2p[1], &c, 1);
+    }
+    exit();
+  }
+  t0 = rdtsc();
+  for(i = 0; i < NSWITCH/2; i++){
+    write(p2c[1], &c, 1);
+    read(c2p[0], &c, 1);
+  }
+  t1 = rdtsc();
+  wait();
+  printf(1, "fork+pipe ping-pong: %d cycles per switch\n", (t1 - t0) / NSWITCH);
+  exit();
+}
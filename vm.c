@@ -87,8 +87,10 @@ mappages(pde_t *pgdir, void *va, uint size, uint pa, int perm)
 //
 // setupkvm() and exec() set up every page table like this:
 //
-//   0..KERNBASE: user memory (text+data+stack+heap), mapped to
+//   0..TRAMPOLINE: user memory (text+data+stack+heap), mapped to
 //                phys memory allocated by the kernel
+//   TRAMPOLINE..KERNBASE: the signal trampoline in kernel text,
+//                read-only to user code
 //   KERNBASE..KERNBASE+EXTMEM: mapped to 0..EXTMEM (for I/O space)
 //   KERNBASE+EXTMEM..data: mapped to EXTMEM..V2P(data)
 //                for the kernel's instructions and r/o data
@@ -100,6 +102,8 @@ mappages(pde_t *pgdir, void *va, uint size, uint pa, int perm)
 // between V2P(end) and the end of physical memory (PHYSTOP)
 // (directly addressable from end..P2V(PHYSTOP)).
 
+extern char call_sigret[];  // trapasm.S
+
 // This table defines the kernel's mappings, which are present in
 // every process's page table.
 static struct kmap {
@@ -108,6 +112,7 @@ static struct kmap {
   uint phys_end;
   int perm;
 } kmap[] = {
+ { (void*)TRAMPOLINE, V2P(call_sigret), V2P(call_sigret)+PGSIZE, PTE_U}, // signal trampoline
  { (void*)KERNBASE, 0,             EXTMEM,    PTE_W}, // I/O space
  { (void*)KERNLINK, V2P(KERNLINK), V2P(data), 0},     // kern text+rodata
  { (void*)data,     V2P(data),     PHYSTOP,   PTE_W}, // kern data+memory
@@ -224,7 +229,7 @@ allocuvm(pde_t *pgdir, uint oldsz, uint newsz)
   char *mem;
   uint a;
 
-  if(newsz >= KERNBASE)
+  if(newsz > TRAMPOLINE)
     return 0;
   if(newsz < oldsz)
     return oldsz;
@@ -287,7 +292,7 @@ freevm(pde_t *pgdir)
 
   if(pgdir == 0)
     panic("freevm: no pgdir");
-  deallocuvm(pgdir, KERNBASE, 0);
+  deallocuvm(pgdir, TRAMPOLINE, 0);
   for(i = 0; i < NPDENTRIES; i++){
     if(pgdir[i] & PTE_P){
       char * v = P2V(PTE_ADDR(pgdir[i]));
@@ -128,6 +128,36 @@ sti(void)
   asm volatile("sti");
 }
 
+// Enable interrupts and halt until the next one arrives.
+// sti takes effect only after the following instruction,
+// so an interrupt pending at the sti still ends the hlt.
+static inline void
+stihlt(void)
+{
+  asm volatile("sti; hlt");
+}
+
+// Low 32 bits of the time-stamp counter. Also usable from
+// user mode, for short interval measurements.
+static inline uint
+rdtsc(void)
+{
+  uint lo;
+
+  asm volatile("rdtsc" : "=a" (lo) : : "edx");
+  return lo;
+}
+
+// Index of the lowest set bit of x, which must not be 0.
+static inline uint
+bsf(uint x)
+{
+  uint r;
+
+  asm volatile("bsfl %1, %0" : "=r" (r) : "rm" (x));
+  return r;
+}
+
 static inline uint
 xchg(volatile uint *addr, uint newval)
 {